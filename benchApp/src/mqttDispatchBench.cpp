@@ -0,0 +1,172 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2026 André Favoto
+
+/*
+  Driver dispatch benchmark.
+
+  Boots an IOC whose MQTT port uses the in-process loopback transport, loads
+  a generated database with <records> I/O Intr records per payload type and
+  injects messages straight into the driver message callback. For each
+  payload type it reports the sustained message rate and the latency of
+  onMessageCb (decode + parameter update + callbacks).
+
+  Usage (from the top of the module):
+    ./bin/<arch>/mqttDispatchBench [records] [messages] [rateHz] [dbdFile]
+
+  records:  records generated per payload type (default 100)
+  messages: messages injected per payload type (default 100000)
+  rateHz:   injection rate, 0 for as fast as possible (default 0)
+  dbdFile:  default dbd/mqttDispatchBench.dbd
+*/
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <numeric>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+#include "epicsExit.h"
+#include "dbAccess.h"
+#include "iocInit.h"
+#include "drvMqtt.h"
+#include "mqttLoopback.h"
+
+extern "C" int mqttDispatchBench_registerRecordDeviceDriver(struct dbBase* pdbbase);
+
+static const char* benchPort = "bench";
+
+struct PayloadType {
+  const char* name;
+  const char* recordType;
+  const char* dtyp;
+  const char* function;
+  const char* extraFields;
+  std::string payload;
+  bool sharedTopic = false; // all records read their own field ("f<index>") of one document topic
+};
+
+static std::string numberList(size_t count, bool floats) {
+  std::string out;
+  for (size_t i = 0; i < count; i++) {
+    if (i > 0) out += ",";
+    out += floats ? std::to_string(i * 0.25) : std::to_string(i * 7);
+  }
+  return out;
+}
+
+/* Gateway-like document with one field per record */
+static std::string fieldDocument(size_t fields) {
+  std::string out = "{";
+  for (size_t i = 0; i < fields; i++) {
+    if (i > 0) out += ",";
+    out += "\"f" + std::to_string(i) + "\":" + std::to_string(i * 0.5);
+  }
+  return out + "}";
+}
+
+static std::vector<PayloadType> payloadTypes(size_t records) {
+  return {
+    { "int", "ai", "asynInt32", "FLAT:INT", "", "123456" },
+    { "float", "ai", "asynFloat64", "FLAT:FLOAT", "", "3.14159" },
+    { "string", "stringin", "asynOctetRead", "FLAT:STRING", "", "benchmark-string" },
+    { "intarray", "waveform", "asynInt32ArrayIn", "FLAT:INTARRAY", "  field(FTVL, \"LONG\")\n  field(NELM, \"256\")\n", numberList(256, false) },
+    { "floatarray", "waveform", "asynFloat64ArrayIn", "FLAT:FLOATARRAY", "  field(FTVL, \"DOUBLE\")\n  field(NELM, \"256\")\n", numberList(256, true) },
+    { "json", "ai", "asynFloat64", "JSON:FLOAT", "",
+      "{\"device\":\"psu-01\",\"status\":{\"on\":true,\"fault\":false},\"current\":12.5,\"voltage\":48.1,\"value\":3.14159}" },
+    { "jsonfields", "ai", "asynFloat64", "JSON:FLOAT", "", fieldDocument(records), true },
+  };
+}
+
+static std::string topicFor(const PayloadType& type, size_t index) {
+  if (type.sharedTopic) return std::string("bench/") + type.name;
+  return std::string("bench/") + type.name + "/" + std::to_string(index);
+}
+
+/* Writes the generated database to a temporary file and returns its path */
+static std::string generateDatabase(const std::vector<PayloadType>& types, size_t records) {
+  char path[] = "/tmp/mqttDispatchBenchXXXXXX";
+  int fd = mkstemp(path);
+  if (fd < 0) {
+    perror("mkstemp");
+    epicsExit(1);
+  }
+  FILE* fp = fdopen(fd, "w");
+  for (const auto& type : types) {
+    for (size_t i = 0; i < records; i++) {
+      std::string link = std::string(type.function) + " " + topicFor(type, i);
+      if (type.sharedTopic) link += " f" + std::to_string(i);
+      else if (std::string(type.function).compare(0, 4, "JSON") == 0) link += " value";
+      fprintf(fp, "record(%s, \"bench:%s:%zu\") {\n", type.recordType, type.name, i);
+      fprintf(fp, "  field(DTYP, \"%s\")\n", type.dtyp);
+      fprintf(fp, "  field(SCAN, \"I/O Intr\")\n");
+      fprintf(fp, "%s", type.extraFields);
+      fprintf(fp, "  field(INP, \"@asyn(%s) %s\")\n}\n", benchPort, link.c_str());
+    }
+  }
+  fclose(fp);
+  return path;
+}
+
+static double percentile(std::vector<double>& sorted, double p) {
+  if (sorted.empty()) return 0;
+  size_t idx = static_cast<size_t>(p * (sorted.size() - 1));
+  return sorted[idx];
+}
+
+int main(int argc, char* argv[]) {
+  size_t records = argc > 1 ? strtoul(argv[1], nullptr, 10) : 100;
+  size_t messages = argc > 2 ? strtoul(argv[2], nullptr, 10) : 100000;
+  double rate = argc > 3 ? strtod(argv[3], nullptr) : 0;
+  const char* dbdFile = argc > 4 ? argv[4] : "dbd/mqttDispatchBench.dbd";
+  if (records == 0 || messages == 0) {
+    fprintf(stderr, "records and messages must be > 0\n");
+    return 1;
+  }
+
+  auto types = payloadTypes(records);
+  std::string dbFile = generateDatabase(types, records);
+
+  if (dbLoadDatabase(dbdFile, NULL, NULL)) {
+    fprintf(stderr, "Failed to load %s (run from the top of the module or pass the dbd path)\n", dbdFile);
+    return 1;
+  }
+  mqttDispatchBench_registerRecordDeviceDriver(pdbbase);
+  mqttDriverConfigure(benchPort, "loopback://bench", "mqttDispatchBench", 0, NULL);
+  dbLoadRecords(dbFile.c_str(), NULL);
+  iocInit();
+  unlink(dbFile.c_str());
+
+  MqttDriver* driver = MqttDriver::findDriver(benchPort);
+  LoopbackTransport* loopback = driver ? dynamic_cast<LoopbackTransport*>(&driver->transport()) : nullptr;
+  if (!loopback) {
+    fprintf(stderr, "Loopback transport not available on port '%s'\n", benchPort);
+    epicsExit(1);
+  }
+
+  printf("%-12s %8s %10s %12s %10s %10s %10s %10s\n",
+    "type", "records", "messages", "msgs/s", "mean(us)", "p50(us)", "p99(us)", "max(us)");
+  for (const auto& type : types) {
+    std::vector<std::string> topics;
+    for (size_t i = 0; i < (type.sharedTopic ? 1 : records); i++) topics.push_back(topicFor(type, i));
+    std::vector<std::string> payloads(topics.size(), type.payload);
+    std::vector<double> latencies;
+
+    // warm up caches and allocations before measuring
+    loopback->injectAtRate(topics, payloads, std::min<size_t>(messages, 1000), 0);
+
+    epicsUInt64 start = epicsMonotonicGet();
+    loopback->injectAtRate(topics, payloads, messages, rate, &latencies);
+    double elapsed = (epicsMonotonicGet() - start) * 1e-9;
+
+    std::sort(latencies.begin(), latencies.end());
+    double mean = std::accumulate(latencies.begin(), latencies.end(), 0.0) / latencies.size();
+    printf("%-12s %8zu %10zu %12.0f %10.2f %10.2f %10.2f %10.2f\n",
+      type.name, records, messages, messages / elapsed, mean * 1e-3,
+      percentile(latencies, 0.50) * 1e-3, percentile(latencies, 0.99) * 1e-3, latencies.back() * 1e-3);
+  }
+
+  epicsExit(0);
+  return 0;
+}
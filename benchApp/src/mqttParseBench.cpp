@@ -0,0 +1,464 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2026 André Favoto
+
+/*
+  Microbenchmarks for the payload parsers and formatters used by the driver.
+
+  Self-contained harness: every case is calibrated to run for at least
+  MIN_TIME seconds, repeated REPETITIONS times, and the fastest repetition
+  is reported. Inputs are generated from a fixed seed, so runs on the same
+  machine are comparable across driver versions.
+
+  Usage:
+    ./bin/<arch>/mqttParseBench [--csv] [filter]
+
+  filter: only run cases whose name contains this string
+*/
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "drvMqtt.h"
+#include "mqttSparkplug.h"
+
+static const double MIN_TIME = 0.05;
+static const int REPETITIONS = 5;
+static const unsigned SEED = 20260101;
+static const size_t ARRAY_SIZES[] = { 1, 16, 256, 4096, 65536 };
+static const size_t JSON_FIELD_COUNTS[] = { 8, 64, 512, 4096 };
+static const size_t SCALAR_BATCH = 1024;
+
+static bool csvOutput = false;
+static const char* nameFilter = nullptr;
+static volatile size_t sink; // keeps results alive so the compiler cannot drop the work
+
+/* Runs fn() (which processes 'items' elements / 'bytes' bytes per call) and prints the result */
+template <typename Fn>
+static void runBench(const std::string& name, size_t size, size_t items, size_t bytes, Fn&& fn) {
+  using clock = std::chrono::steady_clock;
+  if (nameFilter && name.find(nameFilter) == std::string::npos) return;
+
+  size_t iterations = 1;
+  for (;;) {
+    auto start = clock::now();
+    for (size_t i = 0; i < iterations; i++) sink = sink + fn();
+    double elapsed = std::chrono::duration<double>(clock::now() - start).count();
+    if (elapsed >= MIN_TIME) break;
+    iterations *= 2;
+  }
+
+  double best = 1e300;
+  for (int rep = 0; rep < REPETITIONS; rep++) {
+    auto start = clock::now();
+    for (size_t i = 0; i < iterations; i++) sink = sink + fn();
+    double elapsed = std::chrono::duration<double>(clock::now() - start).count();
+    if (elapsed < best) best = elapsed;
+  }
+
+  double nsPerCall = best * 1e9 / iterations;
+  double nsPerItem = nsPerCall / items;
+  double mbPerSec = bytes ? bytes / (nsPerCall * 1e-9) / 1e6 : 0;
+  if (csvOutput)
+    printf("%s,%zu,%.1f,%.2f,%.1f\n", name.c_str(), size, nsPerCall, nsPerItem, mbPerSec);
+  else
+    printf("%-32s %8zu %14.1f %12.2f %10.1f\n", name.c_str(), size, nsPerCall, nsPerItem, mbPerSec);
+}
+
+//#############################################################################################
+// Input generators
+
+static std::string intList(std::mt19937& rng, size_t count, const char* separator, bool brackets) {
+  std::uniform_int_distribution<epicsInt32> dist(-1000000, 1000000);
+  std::string out = brackets ? "[" : "";
+  for (size_t i = 0; i < count; i++) {
+    if (i > 0) out += separator;
+    out += std::to_string(dist(rng));
+  }
+  if (brackets) out += "]";
+  return out;
+}
+
+static std::string floatList(std::mt19937& rng, size_t count, const char* separator, bool brackets) {
+  std::uniform_real_distribution<double> dist(-1e6, 1e6);
+  std::string out = brackets ? "[" : "";
+  char buf[32];
+  for (size_t i = 0; i < count; i++) {
+    if (i > 0) out += separator;
+    snprintf(buf, sizeof(buf), "%.9g", dist(rng));
+    out += buf;
+  }
+  if (brackets) out += "]";
+  return out;
+}
+
+/* Device-like document: groups of sensors with a few properties each. The
+   field looked up by the benchmark ("target") is the last one in the document. */
+static std::string jsonDocument(std::mt19937& rng, size_t fields) {
+  std::uniform_real_distribution<double> dist(0, 100);
+  json doc;
+  doc["device"] = "rack-07";
+  doc["timestamp"] = 1767225600123;
+  size_t groups = fields / 8 + 1;
+  size_t added = 0;
+  for (size_t g = 0; g < groups && added < fields; g++) {
+    json& group = doc["group" + std::to_string(g)];
+    for (size_t f = 0; f < 8 && added < fields; f++, added++) {
+      json& sensor = group["sensor" + std::to_string(f)];
+      sensor["value"] = dist(rng);
+      sensor["unit"] = "degC";
+      sensor["ok"] = true;
+    }
+  }
+  doc["status"]["target"] = 42.5;
+  return doc.dump();
+}
+
+//#############################################################################################
+
+static void benchScalars(std::mt19937& rng) {
+  std::uniform_int_distribution<epicsInt32> intDist(-2000000000, 2000000000);
+  std::uniform_real_distribution<double> floatDist(-1e9, 1e9);
+  std::vector<std::string> ints, floats;
+  char buf[32];
+  for (size_t i = 0; i < SCALAR_BATCH; i++) {
+    ints.push_back(std::to_string(intDist(rng)));
+    snprintf(buf, sizeof(buf), "%.17g", floatDist(rng));
+    floats.push_back(buf);
+  }
+  size_t intBytes = 0, floatBytes = 0;
+  for (const auto& s : ints) intBytes += s.size();
+  for (const auto& s : floats) floatBytes += s.size();
+
+  runBench("isInteger", SCALAR_BATCH, SCALAR_BATCH, intBytes, [&] {
+    size_t n = 0;
+    for (const auto& s : ints) n += MqttDriver::isInteger(s);
+    return n;
+    });
+  runBench("isFloat", SCALAR_BATCH, SCALAR_BATCH, floatBytes, [&] {
+    size_t n = 0;
+    for (const auto& s : floats) n += MqttDriver::isFloat(s);
+    return n;
+    });
+}
+
+static void benchArrays(std::mt19937& rng) {
+  struct Format { const char* name; const char* separator; bool brackets; };
+  const Format formats[] = { { "comma", ",", false }, { "space", " ", false }, { "bracket", ", ", true } };
+
+  for (const auto& format : formats) {
+    for (size_t size : ARRAY_SIZES) {
+      std::string s = intList(rng, size, format.separator, format.brackets);
+      std::vector<epicsInt32> out;
+      runBench(std::string("checkAndParseIntArray/") + format.name, size, size, s.size(), [&] {
+        MqttDriver::checkAndParseIntArray(s, out);
+        return out.size();
+        });
+    }
+  }
+  for (const auto& format : formats) {
+    for (size_t size : ARRAY_SIZES) {
+      std::string s = floatList(rng, size, format.separator, format.brackets);
+      std::vector<epicsFloat64> out;
+      runBench(std::string("checkAndParseFloatArray/") + format.name, size, size, s.size(), [&] {
+        MqttDriver::checkAndParseFloatArray(s, out);
+        return out.size();
+        });
+    }
+  }
+}
+
+/* Narrow element types, text vs packed binary (BIN format) */
+static void benchNarrowArrays(std::mt19937& rng) {
+  std::uniform_int_distribution<int> dist(-32768, 32767);
+  for (size_t size : ARRAY_SIZES) {
+    std::vector<epicsInt16> data(size);
+    for (auto& v : data) v = static_cast<epicsInt16>(dist(rng));
+    std::string text = MqttDriver::formatArray(data.data(), data.size());
+    std::string binary = MqttDriver::encodeBinaryArray(data.data(), data.size());
+    std::vector<epicsInt16> out;
+    runBench("checkAndParseIntArray/int16", size, size, text.size(), [&] {
+      MqttDriver::checkAndParseIntArray(text, out);
+      return out.size();
+      });
+    runBench("decodeBinaryArray/int16", size, size, binary.size(), [&] {
+      MqttDriver::decodeBinaryArray(binary, out);
+      return out.size();
+      });
+  }
+}
+
+static void benchFormatting(std::mt19937& rng) {
+  std::uniform_int_distribution<epicsInt32> intDist(-1000000, 1000000);
+  std::uniform_real_distribution<double> floatDist(-1e6, 1e6);
+  for (size_t size : ARRAY_SIZES) {
+    std::vector<epicsInt32> data(size);
+    for (auto& v : data) v = intDist(rng);
+    runBench("formatArray/int32", size, size, size * sizeof(epicsInt32), [&] {
+      return MqttDriver::formatArray(data.data(), data.size()).size();
+      });
+  }
+  for (size_t size : ARRAY_SIZES) {
+    std::vector<epicsFloat64> data(size);
+    for (auto& v : data) v = floatDist(rng);
+    runBench("formatArray/float64", size, size, size * sizeof(epicsFloat64), [&] {
+      return MqttDriver::formatArray(data.data(), data.size()).size();
+      });
+  }
+}
+
+/* JSON output payloads: precompiled template against building and dumping a document per write */
+static void benchJsonWrites(std::mt19937& rng) {
+  std::uniform_real_distribution<double> floatDist(-1e6, 1e6);
+  const std::string field = "sensor.setpoint";
+  MqttJsonTemplate payloadTemplate(MqttJsonPath::parse(field));
+  std::string payload;
+  std::vector<epicsFloat64> scalars(SCALAR_BATCH);
+  for (auto& v : scalars) v = floatDist(rng);
+  runBench("jsonWrite/float64/template", 1, scalars.size(), 0, [&] {
+    size_t total = 0;
+    for (epicsFloat64 v : scalars) {
+      payloadTemplate.render(v, payload);
+      total += payload.size();
+    }
+    return total;
+    });
+  runBench("jsonWrite/float64/dom", 1, scalars.size(), 0, [&] {
+    size_t total = 0;
+    for (epicsFloat64 v : scalars) {
+      json doc;
+      doc["sensor"]["setpoint"] = v;
+      total += doc.dump().size();
+    }
+    return total;
+    });
+  for (size_t size : ARRAY_SIZES) {
+    std::vector<epicsFloat64> data(size);
+    for (auto& v : data) v = floatDist(rng);
+    runBench("jsonWrite/float64array/template", size, size, size * sizeof(epicsFloat64), [&] {
+      payloadTemplate.renderArray(data.data(), data.size(), payload);
+      return payload.size();
+      });
+    runBench("jsonWrite/float64array/dom", size, size, size * sizeof(epicsFloat64), [&] {
+      json doc;
+      doc["sensor"]["setpoint"] = data;
+      return doc.dump().size();
+      });
+  }
+}
+
+/* Decode + lookup cost of the same documents as JSON text, CBOR and MessagePack */
+static void benchDocumentFormats(std::mt19937& rng) {
+  for (size_t fields : JSON_FIELD_COUNTS) {
+    json root = json::parse(jsonDocument(rng, fields));
+    std::string text = root.dump(), cbor, msgpack;
+    json::to_cbor(root, cbor);
+    json::to_msgpack(root, msgpack);
+    const std::pair<MqttTopicAddr::TopicFormat, const std::string*> payloads[] = {
+      { MqttTopicAddr::JSON, &text }, { MqttTopicAddr::CBOR, &cbor }, { MqttTopicAddr::MSGPACK, &msgpack }
+    };
+    for (const auto& payload : payloads) {
+      const std::string& data = *payload.second;
+      std::string name = std::string("decodeDocument/") + MqttDriver::formatName(payload.first);
+      if (!nameFilter || name.find(nameFilter) != std::string::npos) {
+        fprintf(csvOutput ? stderr : stdout, "# %s %zu: %zu bytes (%.0f%% of JSON)\n", name.c_str(), fields,
+          data.size(), 100.0 * data.size() / text.size());
+      }
+      runBench(name, fields, 1, data.size(), [&] {
+        json parsed = MqttDriver::decodeDocument(payload.first, data);
+        return reinterpret_cast<size_t>(MqttDriver::findJsonField(parsed, "target"));
+        });
+    }
+  }
+}
+
+/* Spectrum-like waveform: a few gaussian peaks on a noisy baseline */
+static std::vector<epicsFloat64> waveform(std::mt19937& rng, size_t count) {
+  std::normal_distribution<double> noise(0, 0.01);
+  std::vector<epicsFloat64> out(count);
+  for (size_t i = 0; i < count; i++) {
+    double x = static_cast<double>(i) / count;
+    out[i] = 100 * exp(-pow((x - 0.3) / 0.02, 2)) + 40 * exp(-pow((x - 0.7) / 0.05, 2)) + noise(rng);
+  }
+  return out;
+}
+
+/* Compression cost and ratio of each codec built in, on FLAT (text) and BIN payloads */
+static void benchCodecs(std::mt19937& rng) {
+  for (MqttCodec codec : mqttCodecsAvailable()) {
+    for (size_t size : ARRAY_SIZES) {
+      if (size < 256) continue; // small payloads are not worth compressing
+      std::vector<epicsFloat64> data = waveform(rng, size);
+      const std::pair<const char*, std::string> inputs[] = {
+        { "flat", MqttDriver::formatArray(data.data(), data.size()) },
+        { "bin", MqttDriver::encodeBinaryArray(data.data(), data.size()) }
+      };
+      for (const auto& input : inputs) {
+        std::string name = std::string("codec/") + mqttCodecName(codec) + "/" + input.first;
+        std::string compressed, decompressed;
+        mqttCompress(codec, input.second, compressed);
+        if (!nameFilter || name.find(nameFilter) != std::string::npos) {
+          fprintf(csvOutput ? stderr : stdout, "# %s %zu: %zu -> %zu bytes, ratio %.2f\n", name.c_str(), size,
+            input.second.size(), compressed.size(), static_cast<double>(input.second.size()) / compressed.size());
+        }
+        runBench(name + "/compress", size, size, input.second.size(), [&] {
+          mqttCompress(codec, input.second, compressed);
+          return compressed.size();
+          });
+        runBench(name + "/decompress", size, size, input.second.size(), [&] {
+          mqttDecompress(codec, compressed, decompressed);
+          return decompressed.size();
+          });
+      }
+    }
+  }
+}
+
+static void protobufVarint(std::string& out, epicsUInt64 value) {
+  for (; value >= 0x80; value >>= 7) out += static_cast<char>((value & 0x7f) | 0x80);
+  out += static_cast<char>(value);
+}
+
+/* Sparkplug B DDATA payload of alias-only Double metrics, as sent after a DBIRTH */
+static std::string sparkplugPayload(std::mt19937& rng, size_t metrics) {
+  std::uniform_real_distribution<double> values(-1e3, 1e3);
+  std::string payload, metric;
+  for (size_t i = 0; i < metrics; i++) {
+    metric.clear();
+    protobufVarint(metric, (2 << 3) | 0); // alias
+    protobufVarint(metric, i);
+    protobufVarint(metric, (13 << 3) | 1); // double_value
+    double value = values(rng);
+    epicsUInt64 bits;
+    memcpy(&bits, &value, sizeof(bits));
+    for (int byte = 0; byte < 8; byte++) metric += static_cast<char>(bits >> (8 * byte));
+    protobufVarint(payload, (2 << 3) | 2); // metrics
+    protobufVarint(payload, metric.size());
+    payload += metric;
+  }
+  return payload;
+}
+
+/* Walk over every metric of a Sparkplug B payload, the per-message decode cost of SPB records */
+static void benchSparkplug(std::mt19937& rng) {
+  for (size_t metrics : JSON_FIELD_COUNTS) {
+    std::string payload = sparkplugPayload(rng, metrics);
+    runBench("sparkplug/decode", metrics, metrics, payload.size(), [&] {
+      MqttSparkplugReader reader(payload);
+      MqttSparkplugMetric metric;
+      double sum = 0;
+      while (reader.next(metric)) sum += metric.toDouble();
+      return static_cast<size_t>(sum);
+      });
+  }
+}
+
+static void benchJson(std::mt19937& rng) {
+  for (size_t fields : JSON_FIELD_COUNTS) {
+    std::string doc = jsonDocument(rng, fields);
+    json root = json::parse(doc);
+    runBench("json::parse", fields, 1, doc.size(), [&] {
+      return json::parse(doc).size();
+      });
+    runBench("findJsonField", fields, 1, doc.size(), [&] {
+      return reinterpret_cast<size_t>(MqttDriver::findJsonField(root, "target"));
+      });
+    runBench("json::parse+findJsonField", fields, 1, doc.size(), [&] {
+      json parsed = json::parse(doc);
+      return reinterpret_cast<size_t>(MqttDriver::findJsonField(parsed, "target"));
+      });
+    // single-pass extraction of a few fields, as done for the records of a topic
+    for (MqttJsonExtractor::Backend backend : { MqttJsonExtractor::BACKEND_NLOHMANN, MqttJsonExtractor::BACKEND_SIMDJSON }) {
+      if (!MqttJsonExtractor::backendAvailable(backend)) continue;
+      MqttJsonExtractor last(json::input_format_t::json, backend), first(json::input_format_t::json, backend);
+      for (const char* field : { "device", "timestamp", "group0.sensor0.value", "target" }) last.addPath(field);
+      for (const char* field : { "device", "timestamp", "group0.sensor0.value" }) first.addPath(field);
+      std::string name = std::string("MqttJsonExtractor/") + MqttJsonExtractor::backendName(backend);
+      runBench(name + "/last", fields, last.pathCount(), doc.size(), [&] {
+        last.extract(doc);
+        return last.value(0)->size();
+        });
+      runBench(name + "/early", fields, first.pathCount(), doc.size(), [&] {
+        first.extract(doc);
+        return first.value(0)->size();
+        });
+    }
+  }
+}
+
+/* Waveform in a JSON document: the whole array captured as text and parsed, vs read as numbers, whole or sliced */
+static void benchJsonSlices(std::mt19937& rng) {
+  for (size_t size : ARRAY_SIZES) {
+    std::string doc = "{\"channels\":[";
+    for (size_t i = 0; i < 32; i++) doc += (i > 0 ? ",{\"value\":" : "{\"value\":") + std::to_string(i) + "}";
+    doc += "],\"data\":" + floatList(rng, size, ",", true) + "}";
+    std::string slice = "data[0:" + std::to_string(size) + "]";
+    for (MqttJsonExtractor::Backend backend : { MqttJsonExtractor::BACKEND_NLOHMANN, MqttJsonExtractor::BACKEND_SIMDJSON }) {
+      if (!MqttJsonExtractor::backendAvailable(backend)) continue;
+      MqttJsonExtractor whole(json::input_format_t::json, backend), sliced(json::input_format_t::json, backend);
+      MqttJsonExtractor array(json::input_format_t::json, backend), indexed(json::input_format_t::json, backend);
+      whole.addPath("data");
+      array.addPath("data", true);
+      sliced.addPath(slice);
+      indexed.addPath("channels[17].value");
+      std::string name = std::string("jsonSlice/") + MqttJsonExtractor::backendName(backend);
+      std::vector<epicsFloat64> out;
+      runBench(name + "/capture+parse", size, size, doc.size(), [&] {
+        whole.extract(doc);
+        MqttDriver::checkAndParseFloatArray(*whole.value(0), out);
+        return out.size();
+        });
+      // elements are already epicsFloat64, like a waveform record reads them
+      auto toWaveform = [](const MqttJsonExtractor& extractor) {
+        const void* data;
+        size_t count = 0;
+        extractor.elements(0, data, count);
+        return count;
+      };
+      runBench(name + "/array", size, size, doc.size(), [&] {
+        array.extract(doc);
+        return toWaveform(array);
+        });
+      runBench(name + "/slice", size, size, doc.size(), [&] {
+        sliced.extract(doc);
+        return toWaveform(sliced);
+        });
+      runBench(name + "/index", size, 1, doc.size(), [&] {
+        indexed.extract(doc);
+        return indexed.value(0)->size();
+        });
+    }
+  }
+}
+
+int main(int argc, char* argv[]) {
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--csv") == 0) csvOutput = true;
+    else nameFilter = argv[i];
+  }
+
+  if (csvOutput)
+    printf("name,size,ns_per_call,ns_per_item,mb_per_s\n");
+  else
+    printf("%-32s %8s %14s %12s %10s\n", "name", "size", "ns/call", "ns/item", "MB/s");
+
+  // each group gets its own generator so adding cases does not change other inputs
+  std::mt19937 scalarRng(SEED), arrayRng(SEED + 1), formatRng(SEED + 2), jsonRng(SEED + 3), narrowRng(SEED + 4);
+  std::mt19937 codecRng(SEED + 5), documentRng(SEED + 6), sparkplugRng(SEED + 7), jsonWriteRng(SEED + 8);
+  std::mt19937 jsonSliceRng(SEED + 9);
+  benchScalars(scalarRng);
+  benchArrays(arrayRng);
+  benchNarrowArrays(narrowRng);
+  benchFormatting(formatRng);
+  benchJsonWrites(jsonWriteRng);
+  benchJson(jsonRng);
+  benchJsonSlices(jsonSliceRng);
+  benchDocumentFormats(documentRng);
+  benchCodecs(codecRng);
+  benchSparkplug(sparkplugRng);
+  return 0;
+}
@@ -19,11 +19,13 @@ epicsEnvSet("QOS", "1")
 epicsEnvSet("P", "mqtt:test:")
 epicsEnvSet("R", "")
 epicsEnvSet("TOPIC_ROOT", "$(MQTT_TEST_TOPIC_ROOT=epicsMQTT/ci/test)")
+epicsEnvSet("SPB_GROUP", "$(MQTT_TEST_SPB_GROUP=epicsMQTT-ci)")
 
 mqttDriverConfigure($(PORT), $(BROKER_URL), $(CLIENT_ID), $(QOS))
+mqttImageConfigure($(PORT), "$(P)Image", "$(TOPIC_ROOT)/image")
 
 ## Load test records
-dbLoadRecords("db/mqttTest.db", "P=$(P),R=$(R),PORT=$(PORT),TOPIC_ROOT=$(TOPIC_ROOT)")
+dbLoadRecords("db/mqttTest.db", "P=$(P),R=$(R),PORT=$(PORT),TOPIC_ROOT=$(TOPIC_ROOT),SPB_GROUP=$(SPB_GROUP)")
 
 cd "${TOP}/iocBoot/${IOC}"
 iocInit
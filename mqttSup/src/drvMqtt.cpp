@@ -1,109 +1,417 @@
 // SPDX-License-Identifier: GPL-3.0-or-later
 // Copyright (C) 2026 André Favoto
 
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <type_traits>
+#include <epicsEndian.h>
+#include <unordered_map>
+#include <epicsExit.h>
 #include "drvMqtt.h"
 #include "mqttClient.h"
+#include "mqttImage.h"
+#include "mqttSparkplug.h"
+#include "mqttSnapshot.h"
 
 // Supported type definitions
 
 #define FLAT_FUNC_PREFIX          "FLAT"
 #define JSON_FUNC_PREFIX          "JSON"
-#define FLAT_INT_FUNC_STR         FLAT_FUNC_PREFIX ":INT"
-#define FLAT_FLOAT_FUNC_STR       FLAT_FUNC_PREFIX ":FLOAT"
-#define FLAT_DIGITAL_FUNC_STR     FLAT_FUNC_PREFIX ":DIGITAL"
-#define FLAT_STRING_FUNC_STR      FLAT_FUNC_PREFIX ":STRING"
-#define FLAT_INTARRAY_FUNC_STR    FLAT_FUNC_PREFIX ":INTARRAY"
-#define FLAT_FLOATARRAY_FUNC_STR  FLAT_FUNC_PREFIX ":FLOATARRAY"
-#define JSON_INT_FUNC_STR         JSON_FUNC_PREFIX ":INT"
-#define JSON_FLOAT_FUNC_STR       JSON_FUNC_PREFIX ":FLOAT"
-#define JSON_DIGITAL_FUNC_STR     JSON_FUNC_PREFIX ":DIGITAL"
-#define JSON_STRING_FUNC_STR      JSON_FUNC_PREFIX ":STRING"
-#define JSON_INTARRAY_FUNC_STR    JSON_FUNC_PREFIX ":INTARRAY"
-#define JSON_FLOATARRAY_FUNC_STR  JSON_FUNC_PREFIX ":FLOATARRAY"
-
-const std::unordered_set<std::string> MqttDriver::supportedTopicTypes = {
-  FLAT_INT_FUNC_STR,
-  FLAT_FLOAT_FUNC_STR,
-  FLAT_DIGITAL_FUNC_STR,
-  FLAT_STRING_FUNC_STR,
-  FLAT_INTARRAY_FUNC_STR,
-  FLAT_FLOATARRAY_FUNC_STR,
-  JSON_INT_FUNC_STR,
-  JSON_FLOAT_FUNC_STR,
-  JSON_DIGITAL_FUNC_STR,
-  JSON_STRING_FUNC_STR,
-  JSON_INTARRAY_FUNC_STR,
-  JSON_FLOATARRAY_FUNC_STR
+#define BIN_FUNC_PREFIX           "BIN"
+#define CBOR_FUNC_PREFIX          "CBOR"
+#define MSGPACK_FUNC_PREFIX       "MSGPACK"
+#define SPB_FUNC_PREFIX           "SPB"
+#define INT_TYPE_STR              ":INT"
+#define INT64_TYPE_STR            ":INT64"
+#define FLOAT_TYPE_STR            ":FLOAT"
+#define DIGITAL_TYPE_STR          ":DIGITAL"
+#define STRING_TYPE_STR           ":STRING"
+#define INT8ARRAY_TYPE_STR        ":INT8ARRAY"
+#define INT16ARRAY_TYPE_STR       ":INT16ARRAY"
+#define INTARRAY_TYPE_STR         ":INTARRAY"
+#define INT64ARRAY_TYPE_STR       ":INT64ARRAY"
+#define FLOAT32ARRAY_TYPE_STR     ":FLOAT32ARRAY"
+#define FLOATARRAY_TYPE_STR       ":FLOATARRAY"
+
+static const char* const scalarTypeStrs[] = {
+  INT_TYPE_STR, INT64_TYPE_STR, FLOAT_TYPE_STR, DIGITAL_TYPE_STR, STRING_TYPE_STR
 };
+static const char* const arrayTypeStrs[] = {
+  INT8ARRAY_TYPE_STR, INT16ARRAY_TYPE_STR, INTARRAY_TYPE_STR, INT64ARRAY_TYPE_STR, FLOAT32ARRAY_TYPE_STR, FLOATARRAY_TYPE_STR
+};
+
+/* Array types optionally take a compression codec suffix, e.g. "FLAT:FLOATARRAY:lz4" */
+static std::vector<std::string> codecSuffixes() {
+  std::vector<std::string> suffixes = { "" };
+  for (MqttCodec codec : mqttCodecsAvailable()) suffixes.push_back(std::string(":") + mqttCodecName(codec));
+  return suffixes;
+}
+
+// FLAT and the document formats support every type, BIN (raw binary payloads) only arrays.
+// SPB (Sparkplug B) supports every type but no codecs, its payloads are protobuf.
+const std::unordered_set<std::string> MqttDriver::supportedTopicTypes = [] {
+  std::unordered_set<std::string> types;
+  for (const char* prefix : { FLAT_FUNC_PREFIX, JSON_FUNC_PREFIX, CBOR_FUNC_PREFIX, MSGPACK_FUNC_PREFIX, SPB_FUNC_PREFIX }) {
+    for (const char* type : scalarTypeStrs) types.insert(std::string(prefix) + type);
+  }
+  for (const char* prefix : { FLAT_FUNC_PREFIX, JSON_FUNC_PREFIX, CBOR_FUNC_PREFIX, MSGPACK_FUNC_PREFIX, BIN_FUNC_PREFIX }) {
+    for (const char* type : arrayTypeStrs) {
+      for (const auto& suffix : codecSuffixes()) types.insert(std::string(prefix) + type + suffix);
+    }
+  }
+  for (const char* type : arrayTypeStrs) types.insert(std::string(SPB_FUNC_PREFIX) + type);
+  return types;
+}();
 //#############################################################################################
 // autoParam-specific definitions
 
 // Overloads the operator '==' to compare MqttTopicAddr objects created on record I/O links
 bool MqttTopicAddr::operator==(DeviceAddress const& comparedAddr) const {
   const MqttTopicAddr& cmp = static_cast<const MqttTopicAddr&>(comparedAddr);
-  if (format != cmp.format) return false;
+  if (format != cmp.format || codec != cmp.codec) return false;
   switch (format) {
     case FLAT:
-      return topicName == cmp.topicName;
+    case BIN:
+      return topic == cmp.topic;
     case JSON:
-      return topicName == cmp.topicName && jsonField == cmp.jsonField;
+    case CBOR:
+    case MSGPACK:
+      return topic == cmp.topic && jsonField == cmp.jsonField;
+    case SPB:
+      return sparkplugDevice == cmp.sparkplugDevice && jsonField == cmp.jsonField;
   }
   return false;
 }
 
+//#############################################################################################
+// Record addresses
+
+/*
+  Addresses are allocated in blocks: large databases parse one per record
+  link at iocInit and autoparam keeps them for the life of the IOC, so one
+  heap allocation per address only fragments the heap. Slots of deleted
+  addresses (rejected links, duplicates merged by autoparam) are reused.
+*/
+namespace {
+class AddressPool {
+public:
+  void* allocate() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (free_) {
+      Slot* slot = free_;
+      free_ = slot->next;
+      return slot;
+    }
+    if (blocks_.empty() || used_ == BLOCK_SIZE) {
+      blocks_.emplace_back(new Slot[BLOCK_SIZE]);
+      used_ = 0;
+    }
+    return &blocks_.back()[used_++];
+  }
+  void release(void* ptr) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    Slot* slot = static_cast<Slot*>(ptr);
+    slot->next = free_;
+    free_ = slot;
+  }
+
+private:
+  static const size_t BLOCK_SIZE = 1024;
+  union Slot {
+    Slot* next;
+    alignas(MqttTopicAddr) unsigned char storage[sizeof(MqttTopicAddr)];
+  };
+  std::mutex mutex_;
+  std::vector<std::unique_ptr<Slot[]>> blocks_;
+  size_t used_ = 0;
+  Slot* free_ = nullptr;
+};
+
+/* never destroyed: autoparam may delete its addresses after static destructors ran */
+AddressPool& addressPool() {
+  static AddressPool* pool = new AddressPool();
+  return *pool;
+}
+}
+
+void* MqttTopicAddr::operator new(size_t size) {
+  return size == sizeof(MqttTopicAddr) ? addressPool().allocate() : ::operator new(size);
+}
+
+void MqttTopicAddr::operator delete(void* ptr, size_t size) {
+  if (size == sizeof(MqttTopicAddr)) addressPool().release(ptr);
+  else ::operator delete(ptr);
+}
+
+/* Times the parsing of every record link, see startupReport */
 DeviceAddress* MqttDriver::parseDeviceAddress(std::string const& function, std::string const& arguments) {
+  epicsUInt64 start = epicsMonotonicGet();
+  MqttTopicAddr* addr = parseTopicAddress(function, arguments);
+  startup.parseNs += epicsMonotonicGet() - start;
+  startup.addresses++;
+  if (!addr) startup.rejected++;
+  return addr;
+}
+
+MqttTopicAddr* MqttDriver::parseTopicAddress(std::string const& function, std::string_view arguments) {
   const char* functionName = __FUNCTION__;
-  MqttTopicAddr* addr = new MqttTopicAddr;
   if (!isSupportedTopicType(function)) {
     fprintf(stderr, "%s::%s: Invalid topic type: %s\n", driverName, functionName, function.c_str());
-    delete addr;
     return nullptr;
   }
+  std::unique_ptr<MqttTopicAddr> addr(new MqttTopicAddr);
   auto colonPos = function.find(':');
-  std::string prefix = function.substr(0, colonPos);
-  if (prefix == FLAT_FUNC_PREFIX) {
-    std::string topicName = arguments;
-    if (!isValidTopicName(topicName)) {
-      fprintf(stderr, "%s::%s: Invalid topic name: %s\n", driverName, functionName, topicName.c_str());
-      delete addr;
+  std::string_view prefix = std::string_view(function).substr(0, colonPos);
+  if (prefix == FLAT_FUNC_PREFIX || prefix == BIN_FUNC_PREFIX) {
+    if (!isValidTopicName(arguments)) {
+      fprintf(stderr, "%s::%s: Invalid topic name: %.*s\n", driverName, functionName,
+        static_cast<int>(arguments.size()), arguments.data());
       return nullptr;
     }
-    addr->format = MqttTopicAddr::FLAT;
-    addr->topicName = topicName;
+    addr->format = prefix == BIN_FUNC_PREFIX ? MqttTopicAddr::BIN : MqttTopicAddr::FLAT;
+    addr->topic = MqttTopic::intern(arguments);
   }
-  else if (prefix == JSON_FUNC_PREFIX) {
+  else if (prefix == JSON_FUNC_PREFIX || prefix == CBOR_FUNC_PREFIX || prefix == MSGPACK_FUNC_PREFIX) {
     auto spacePos = arguments.find(' ');
-    if (spacePos == std::string::npos) {
-      fprintf(stderr, "%s::%s: JSON field not specified: %s\n", driverName, functionName, arguments.c_str());
-      delete addr;
+    if (spacePos == std::string_view::npos) {
+      fprintf(stderr, "%s::%s: JSON field not specified: %.*s\n", driverName, functionName,
+        static_cast<int>(arguments.size()), arguments.data());
       return nullptr;
     }
     if (spacePos + 1 >= arguments.size()) {
-      fprintf(stderr, "%s::%s: JSON field is empty: %s\n", driverName, functionName, arguments.c_str());
-      delete addr;
+      fprintf(stderr, "%s::%s: JSON field is empty: %.*s\n", driverName, functionName,
+        static_cast<int>(arguments.size()), arguments.data());
       return nullptr;
     }
-    std::string topicName = arguments.substr(0, spacePos);
+    std::string_view topicName = arguments.substr(0, spacePos);
     if (!isValidTopicName(topicName)) {
-      fprintf(stderr, "%s::%s: Invalid topic name: %s\n", driverName, functionName, topicName.c_str());
-      delete addr;
+      fprintf(stderr, "%s::%s: Invalid topic name: %.*s\n", driverName, functionName,
+        static_cast<int>(topicName.size()), topicName.data());
       return nullptr;
     }
-    std::string jsonField = arguments.substr(spacePos + 1, arguments.size());
-    addr->format = MqttTopicAddr::JSON;
-    addr->topicName = topicName;
-    addr->jsonField = jsonField;
+    addr->jsonField.assign(arguments.substr(spacePos + 1));
+    MqttJsonPath path;
+    try {
+      path = MqttJsonPath::parse(addr->jsonField);
+    }
+    catch (const std::invalid_argument& exc) {
+      fprintf(stderr, "%s::%s: %s\n", driverName, functionName, exc.what());
+      return nullptr;
+    }
+    if (path.isSlice() && function.find("ARRAY") == std::string::npos) {
+      fprintf(stderr, "%s::%s: JSON slices need an array type: %s %s\n", driverName, functionName,
+        function.c_str(), addr->jsonField.c_str());
+      return nullptr;
+    }
+    addr->format = prefix == CBOR_FUNC_PREFIX ? MqttTopicAddr::CBOR
+      : prefix == MSGPACK_FUNC_PREFIX ? MqttTopicAddr::MSGPACK : MqttTopicAddr::JSON;
+    addr->topic = MqttTopic::intern(topicName);
+    if (addr->format == MqttTopicAddr::JSON) addr->jsonTemplate = MqttJsonTemplate(path);
+    else if (path.keysOnly()) {
+      for (const auto& step : path.steps) addr->documentKeys.push_back(step.key);
+    }
+  }
+  else if (prefix == SPB_FUNC_PREFIX) {
+    // "group/edge node/device/metric name", device empty for node metrics; metric names may contain '/'
+    size_t slashes[3];
+    size_t pos = 0;
+    for (size_t i = 0; i < 3; i++) {
+      slashes[i] = arguments.find('/', pos);
+      if (slashes[i] == std::string_view::npos) break;
+      pos = slashes[i] + 1;
+    }
+    if (slashes[0] == std::string_view::npos || slashes[1] == std::string_view::npos
+      || slashes[2] == std::string_view::npos || slashes[2] + 1 >= arguments.size()) {
+      fprintf(stderr, "%s::%s: Expected 'group/edge node/device/metric name': %.*s\n", driverName, functionName,
+        static_cast<int>(arguments.size()), arguments.data());
+      return nullptr;
+    }
+    std::string_view group = arguments.substr(0, slashes[0]);
+    std::string_view edgeNode = arguments.substr(slashes[0] + 1, slashes[1] - slashes[0] - 1);
+    std::string_view device = arguments.substr(slashes[1] + 1, slashes[2] - slashes[1] - 1);
+    if (group.empty() || edgeNode.empty() || !isValidTopicName(arguments.substr(0, slashes[2]))) {
+      fprintf(stderr, "%s::%s: Invalid Sparkplug group/edge node/device: %.*s\n", driverName, functionName,
+        static_cast<int>(arguments.size()), arguments.data());
+      return nullptr;
+    }
+    // the routing key has a wildcard on the message type; the whole node is subscribed, so device
+    // records also get the node's NBIRTH/NDEATH ("a/#" matches "a" as well)
+    std::string key("spBv1.0/");
+    key.append(group).append("/+/").append(edgeNode);
+    addr->topic = MqttTopic::intern(key + "/#");
+    if (!device.empty()) key.append("/").append(device);
+    addr->format = MqttTopicAddr::SPB;
+    addr->sparkplugDevice = MqttTopic::intern(key);
+    addr->jsonField.assign(arguments.substr(slashes[2] + 1));
   }
   else {
-    delete addr;
     return nullptr;
   }
+  auto codecPos = function.find(':', colonPos + 1);
+  if (codecPos != std::string::npos) addr->codec = mqttCodecFromName(function.substr(codecPos + 1));
 
-  return addr;
+  return addr.release();
 }
 
+/* Times the binding of every record variable, see startupReport */
 DeviceVariable* MqttDriver::createDeviceVariable(DeviceVariable* baseVar) {
-  return new MqttTopicVariable(this, baseVar);
+  epicsUInt64 start = epicsMonotonicGet();
+  DeviceVariable* deviceVar = createTopicVariable(baseVar);
+  startup.bindNs += epicsMonotonicGet() - start;
+  startup.variables++;
+  return deviceVar;
+}
+
+MqttTopicVariable* MqttDriver::createTopicVariable(DeviceVariable* baseVar) {
+  auto* deviceVar = new MqttTopicVariable(this, baseVar);
+  MqttTopicAddr const& addr = static_cast<MqttTopicAddr const&>(deviceVar->address());
+  if (addr.format == MqttTopicAddr::SPB) {
+    sparkplugDevices[addr.sparkplugDevice.name()].byName[addr.jsonField].vars.push_back(deviceVar);
+    return deviceVar;
+  }
+
+  // message dispatch goes through the records of each topic, see onMessageCb
+  asynParamType type = deviceVar->asynType();
+  std::vector<TopicRecord>& records = topicRecords[addr.topic.name()];
+  deviceVar->topicRecord = records.size();
+  records.emplace_back();
+  TopicRecord& record = records.back();
+  record.var = deviceVar;
+  record.codec = addr.codec;
+  record.update = updaterFor(type);
+  record.numeric = type == asynParamInt32 || type == asynParamInt64 || type == asynParamFloat64
+    || type == asynParamUInt32Digital;
+  if (addr.isDocument()) {
+    // records of a topic share one extractor, which reads all their fields in a single pass
+    json::input_format_t input = addr.format == MqttTopicAddr::CBOR ? json::input_format_t::cbor
+      : addr.format == MqttTopicAddr::MSGPACK ? json::input_format_t::msgpack : json::input_format_t::json;
+    std::string key = std::string(formatName(addr.format)) + ":" + mqttCodecName(addr.codec) + " " + addr.topic.name();
+    record.extractor = &documentExtractors.emplace(key, MqttJsonExtractor(input)).first->second;
+    // array records read the numbers of JSON arrays directly, without their text, in their own type
+    bool asArray = !record.numeric && type != asynParamOctet;
+    record.slot = record.extractor->addPath(addr.jsonField, asArray, elementTypeFor(type));
+  }
+  return deviceVar;
+}
+
+/*
+  Parses the mqttDriverConfigure options string: "key=value" pairs separated
+  by commas, e.g. "warmStartTimeout=5". NULL or empty gives the defaults.
+*/
+MqttDriver::Options MqttDriver::Options::parse(const char* str) {
+  Options opts;
+  if (!str) return opts;
+  std::stringstream ss(str);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    item.erase(0, item.find_first_not_of(" \t"));
+    item.erase(item.find_last_not_of(" \t") + 1);
+    if (item.empty()) continue;
+    auto eqPos = item.find('=');
+    if (eqPos == std::string::npos)
+      throw std::invalid_argument("Malformed option (expected key=value): " + item);
+    std::string key = item.substr(0, eqPos);
+    std::string value = item.substr(eqPos + 1);
+    if (key == "warmStartTimeout") {
+      if (!isFloat(value) || std::stod(value) < 0)
+        throw std::invalid_argument("Invalid value for " + key + ": " + value);
+      opts.warmStartTimeout = std::stod(value);
+    }
+    else if (key == "snapshotFile") {
+      opts.snapshotFile = value;
+    }
+    else if (key == "snapshotPeriod") {
+      if (!isFloat(value) || std::stod(value) <= 0)
+        throw std::invalid_argument("Invalid value for " + key + ": " + value);
+      opts.snapshotPeriod = std::stod(value);
+    }
+    else if (key == "snapshotSeverity") {
+      if (value == "NO_ALARM") opts.snapshotSeverity = epicsSevNone;
+      else if (value == "MINOR") opts.snapshotSeverity = epicsSevMinor;
+      else if (value == "MAJOR") opts.snapshotSeverity = epicsSevMajor;
+      else if (value == "INVALID") opts.snapshotSeverity = epicsSevInvalid;
+      else throw std::invalid_argument("Invalid value for " + key + " (NO_ALARM|MINOR|MAJOR|INVALID): " + value);
+    }
+    else if (key == "cleanStart") {
+      if (!isBoolean(value) && value != "0" && value != "1")
+        throw std::invalid_argument("Invalid value for " + key + ": " + value);
+      opts.cleanStart = (value == "true" || value == "1");
+    }
+    else if (key == "sessionExpiry") {
+      if (!isInteger(value, false))
+        throw std::invalid_argument("Invalid value for " + key + ": " + value);
+      opts.sessionExpiry = std::stoi(value);
+    }
+    else if (key == "persistDir") {
+      opts.persistDir = value;
+    }
+    else if (key == "reconnectMinDelay" || key == "reconnectMaxDelay") {
+      if (!isFloat(value) || std::stod(value) <= 0)
+        throw std::invalid_argument("Invalid value for " + key + ": " + value);
+      (key == "reconnectMinDelay" ? opts.reconnectMinDelay : opts.reconnectMaxDelay) = std::stod(value);
+    }
+    else if (key == "reconnectJitter") {
+      if (!isFloat(value) || std::stod(value) < 0 || std::stod(value) > 1)
+        throw std::invalid_argument("Invalid value for " + key + " (0 to 1): " + value);
+      opts.reconnectJitter = std::stod(value);
+    }
+    else if (key == "lazySubscribe") {
+      if (!isBoolean(value) && value != "0" && value != "1")
+        throw std::invalid_argument("Invalid value for " + key + ": " + value);
+      opts.lazySubscribe = (value == "true" || value == "1");
+    }
+    else if (key == "lazyIdleTimeout") {
+      if (!isFloat(value) || std::stod(value) < 0)
+        throw std::invalid_argument("Invalid value for " + key + ": " + value);
+      opts.lazyIdleTimeout = std::stod(value);
+    }
+    else {
+      throw std::invalid_argument("Unknown option: " + key);
+    }
+  }
+  if (opts.reconnectMaxDelay < opts.reconnectMinDelay)
+    throw std::invalid_argument("reconnectMaxDelay must not be smaller than reconnectMinDelay");
+  if (!opts.cleanStart && opts.sessionExpiry == 0)
+    throw std::invalid_argument("cleanStart=0 needs a sessionExpiry above 0, the session would end with the connection");
+  return opts;
+}
+
+MqttDriver* MqttDriver::findDriver(const char* portName) {
+  if (!portName) return nullptr;
+  return dynamic_cast<MqttDriver*>(findAsynPortDriver(portName));
+}
+
+void MqttDriver::traceDump(FILE* fp, size_t count) const {
+  fprintf(fp, "%s: port '%s'\n", driverName, portName);
+  trace.dump(fp, count);
+}
+
+/*
+  Startup cost of the port: record link parsing and variable binding at
+  iocInit, then connection and subscription setup. Times are wall-clock, so
+  compare reports of the same database and host to spot regressions.
+*/
+void MqttDriver::startupReport(FILE* fp) {
+  lock();
+  StartupStats stats = startup;
+  size_t topicCount = topicRecords.size() + sparkplugDevices.size();
+  unlock();
+  auto ms = [](epicsUInt64 ns) { return ns * 1e-6; };
+  fprintf(fp, "%s: port '%s' startup\n", driverName, portName);
+  fprintf(fp, "  addresses parsed:   %zu (%zu rejected) in %.3f ms (%.3f us each)\n", stats.addresses, stats.rejected,
+    ms(stats.parseNs), stats.addresses ? stats.parseNs * 1e-3 / stats.addresses : 0.0);
+  fprintf(fp, "  variables bound:    %zu on %zu topics in %.3f ms\n", stats.variables, topicCount, ms(stats.bindNs));
+  fprintf(fp, "  interned topics:    %zu (all ports)\n", MqttTopic::count());
+  if (stats.connects == 0) {
+    fprintf(fp, "  not connected yet\n");
+    return;
+  }
+  fprintf(fp, "  connected:          %.3f ms after iocInit, %zu connections\n", ms(stats.connectNs), stats.connects);
+  fprintf(fp, "  subscription setup: %zu topics in %.3f ms (last connection)\n", stats.subscribedTopics,
+    ms(stats.subscribeNs));
 }
 
 //#############################################################################################
@@ -113,9 +421,10 @@ DeviceVariable* MqttDriver::createDeviceVariable(DeviceVariable* baseVar) {
  * @param brokerUrl Broker IP or hostname (e.g: mqtt://localhost:1883)
  * @param mqttClientID ClientID to be used - must be unique
  * @param qos Desired quality of service (QoS) for the connection [0|1|2]
- * @param timeout Connection timeout to be used
+ * @param options Optional driver settings (see MqttDriver::Options)
 */
-MqttDriver::MqttDriver(const char* portName, const char* brokerUrl, const char* mqttClientID, const int qos)
+MqttDriver::MqttDriver(const char* portName, const char* brokerUrl, const char* mqttClientID, const int qos,
+  const Options& options)
   : Autoparam::Driver(
     portName,
     Autoparam::DriverOpts()
@@ -123,35 +432,47 @@ MqttDriver::MqttDriver(const char* portName, const char* brokerUrl, const char*
     .setAutoInterrupts(false)
     .setInitHook((initHook))
   ),
-  mqttClient([&] {
-  MqttClient::Config cfg;
+  mqttClient(MqttTransport::create([&] {
+  MqttTransport::Config cfg;
   cfg.brokerUrl = brokerUrl;
   cfg.clientId = mqttClientID;
   cfg.qos = qos;
+  cfg.cleanStart = options.cleanStart;
+  cfg.sessionExpiry = options.sessionExpiry;
+  cfg.persistDir = options.persistDir;
+  cfg.reconnectMinDelay = options.reconnectMinDelay;
+  cfg.reconnectMaxDelay = options.reconnectMaxDelay;
+  cfg.reconnectJitter = options.reconnectJitter;
   return cfg;
-    }())
+    }())),
+  options(options),
+  warmDoneEvent(epicsEventMustCreate(epicsEventEmpty)),
+  snapshotStopEvent(epicsEventMustCreate(epicsEventEmpty)),
+  snapshotDoneEvent(epicsEventMustCreate(epicsEventEmpty)),
+  lazyStopEvent(epicsEventMustCreate(epicsEventEmpty)),
+  lazyDoneEvent(epicsEventMustCreate(epicsEventEmpty))
 {
-  mqttClient.setMessageCb([this](const std::string& topic, const std::string& payload) {
+  mqttClient->setMessageCb([this](const std::string& topic, const std::string& payload) {
     onMessageCb(this, topic, payload);
     });
 
-  mqttClient.setConnectionCb([this](const std::string& reason) {
+  mqttClient->setConnectionCb([this](const std::string& reason) {
     onConnectCb(this, reason);
     });
 
-  mqttClient.setDisconnectionCb([this](const std::string& reason) {
+  mqttClient->setDisconnectionCb([this](const std::string& reason) {
     onDisconnectCb(this, reason);
     });
 
-  mqttClient.setSubscriptionCb([this](const std::string& topic) {
+  mqttClient->setSubscriptionCb([this](const std::string& topic) {
     onSubscribeCb(this, topic);
     });
 
-  mqttClient.setPublishCb([this](const std::string& topic) {
+  mqttClient->setPublishCb([this](const std::string& topic) {
     onPublishCb(this, topic);
     });
 
-  mqttClient.setOpFailCb([this](const std::string& errMsg) {
+  mqttClient->setOpFailCb([this](const std::string& errMsg) {
     onFailCb(this, errMsg);
     });
   /*
@@ -160,32 +481,96 @@ MqttDriver::MqttDriver(const char* portName, const char* brokerUrl, const char*
     and leave it to the default asynPortDriver implementation.
   */
 
-  // flat topic support
-  registerHandlers<epicsInt32>(FLAT_INT_FUNC_STR, NULL, integerWrite, NULL);
-  registerHandlers<epicsFloat64>(FLAT_FLOAT_FUNC_STR, NULL, floatWrite, NULL);
-  registerHandlers<epicsUInt32>(FLAT_DIGITAL_FUNC_STR, NULL, digitalWrite, NULL);
-  registerHandlers<Octet>(FLAT_STRING_FUNC_STR, NULL, stringWrite, NULL);
-  registerHandlers<Array<epicsInt32>>(FLAT_INTARRAY_FUNC_STR, NULL, arrayWrite, NULL);
-  registerHandlers<Array<epicsFloat64>>(FLAT_FLOATARRAY_FUNC_STR, NULL, arrayWrite, NULL);
-
-  // json topic support
-  registerHandlers<epicsInt32>(JSON_INT_FUNC_STR, NULL, integerWrite, NULL);
-  registerHandlers<epicsFloat64>(JSON_FLOAT_FUNC_STR, NULL, floatWrite, NULL);
-  registerHandlers<epicsUInt32>(JSON_DIGITAL_FUNC_STR, NULL, digitalWrite, NULL);
-  registerHandlers<Octet>(JSON_STRING_FUNC_STR, NULL, stringWrite, NULL);
-  registerHandlers<Array<epicsInt32>>(JSON_INTARRAY_FUNC_STR, NULL, arrayWrite, NULL);
-  registerHandlers<Array<epicsFloat64>>(JSON_FLOATARRAY_FUNC_STR, NULL, arrayWrite, NULL);
+  registerFormat(FLAT_FUNC_PREFIX, true);
+  registerFormat(JSON_FUNC_PREFIX, true);
+  registerFormat(CBOR_FUNC_PREFIX, true);
+  registerFormat(MSGPACK_FUNC_PREFIX, true);
+  registerFormat(SPB_FUNC_PREFIX, true, false, false); // NCMD/DCMD commands are not published
+  registerFormat(BIN_FUNC_PREFIX, false);
 }
+
+void MqttDriver::registerFormat(const std::string& prefix, bool withScalars, bool withCodecs, bool withWrites) {
+  if (withScalars) {
+    registerHandlers<epicsInt32>(prefix + INT_TYPE_STR, NULL, withWrites ? integerWrite<epicsInt32> : nullptr, interruptRegistrar);
+    registerHandlers<epicsInt64>(prefix + INT64_TYPE_STR, NULL, withWrites ? integerWrite<epicsInt64> : nullptr, interruptRegistrar);
+    registerHandlers<epicsFloat64>(prefix + FLOAT_TYPE_STR, NULL, withWrites ? floatWrite : nullptr, interruptRegistrar);
+    registerHandlers<epicsUInt32>(prefix + DIGITAL_TYPE_STR, NULL, withWrites ? digitalWrite : nullptr, interruptRegistrar);
+    registerHandlers<Octet>(prefix + STRING_TYPE_STR, NULL, withWrites ? stringWrite : nullptr, interruptRegistrar);
+  }
+  for (const auto& suffix : withCodecs ? codecSuffixes() : std::vector<std::string>{ "" }) {
+    registerHandlers<Array<epicsInt8>>(prefix + INT8ARRAY_TYPE_STR + suffix, NULL,
+      withWrites ? arrayWrite<epicsInt8> : nullptr, interruptRegistrar);
+    registerHandlers<Array<epicsInt16>>(prefix + INT16ARRAY_TYPE_STR + suffix, NULL,
+      withWrites ? arrayWrite<epicsInt16> : nullptr, interruptRegistrar);
+    registerHandlers<Array<epicsInt32>>(prefix + INTARRAY_TYPE_STR + suffix, NULL,
+      withWrites ? arrayWrite<epicsInt32> : nullptr, interruptRegistrar);
+    registerHandlers<Array<epicsInt64>>(prefix + INT64ARRAY_TYPE_STR + suffix, NULL,
+      withWrites ? arrayWrite<epicsInt64> : nullptr, interruptRegistrar);
+    registerHandlers<Array<epicsFloat32>>(prefix + FLOAT32ARRAY_TYPE_STR + suffix, NULL,
+      withWrites ? arrayWrite<epicsFloat32> : nullptr, interruptRegistrar);
+    registerHandlers<Array<epicsFloat64>>(prefix + FLOATARRAY_TYPE_STR + suffix, NULL,
+      withWrites ? arrayWrite<epicsFloat64> : nullptr, interruptRegistrar);
+  }
+}
+
 /* Class destructor
    - Disconnects from the broker and cleans session
 */
 MqttDriver::~MqttDriver() {
-  mqttClient.disconnect();
+  stopLazyTask(); // it unsubscribes through the client
+  mqttClient->disconnect();
+  epicsEventDestroy(warmDoneEvent);
+  stopSnapshotTask();
+  epicsEventDestroy(snapshotStopEvent);
+  epicsEventDestroy(snapshotDoneEvent);
+  epicsEventDestroy(lazyStopEvent);
+  epicsEventDestroy(lazyDoneEvent);
 }
 
 void MqttDriver::initHook(Autoparam::Driver* driver) {
   auto* pself = static_cast<MqttDriver*>(driver);
-  pself->mqttClient.connect();
+  pself->started = true;
+  pself->startup.initNs = epicsMonotonicGet();
+  if (!pself->options.snapshotFile.empty()) {
+    pself->loadSnapshot();
+    pself->snapshotRunning = epicsThreadCreate("mqttSnapshot", epicsThreadPriorityLow,
+      epicsThreadGetStackSize(epicsThreadStackSmall), snapshotTask, pself) != nullptr;
+    epicsAtExit(snapshotAtExit, pself);
+  }
+  if (pself->options.lazySubscribe) {
+    pself->lazyRunning = epicsThreadCreate("mqttLazy", epicsThreadPriorityLow,
+      epicsThreadGetStackSize(epicsThreadStackSmall), lazyTask, pself) != nullptr;
+  }
+  if (pself->options.warmStartTimeout > 0) {
+    pself->warmStart();
+    return;
+  }
+  pself->mqttClient->connect();
+}
+
+/*
+  Connects and blocks iocInit until every subscribed topic delivered a
+  message (normally its retained value) or warmStartTimeout expires, so
+  input records start with values instead of staying UDF until the next
+  publish. Topics are marked as warmed in onMessageCb.
+*/
+void MqttDriver::warmStart() {
+  epicsUInt64 start = epicsMonotonicGet();
+  lock();
+  warmingUp = true;
+  unlock();
+
+  mqttClient->connect();
+  epicsEventWaitWithTimeout(warmDoneEvent, options.warmStartTimeout);
+
+  lock();
+  warmingUp = false;
+  size_t total = warmTopicCount;
+  size_t warmed = total - warmPendingTopics.size();
+  warmPendingTopics.clear();
+  unlock();
+  printf("%s: port '%s' warm start: %zu/%zu topics warmed in %.3f s\n",
+    driverName, portName, warmed, total, (epicsMonotonicGet() - start) * 1e-9);
 }
 //#############################################################################################
 //Callback definitons
@@ -201,16 +586,81 @@ void MqttDriver::onConnectCb(Autoparam::Driver* driver, const std::string& reaso
     */
     asynPrint(pself->pasynUserSelf, ASYN_TRACEIO_DRIVER | ASYN_TRACE_ERROR,
       "%s::%s: Reconnected.\n", driverName, functionName);
+    pself->trace.counters.reconnects.fetch_add(1, std::memory_order_relaxed);
+  }
+  else if (reason == MqttClient::CONNECT_RETRY_REASON) {
+    // the failed attempts were reported as errors too
+    asynPrint(pself->pasynUserSelf, ASYN_TRACEIO_DRIVER | ASYN_TRACE_ERROR,
+      "%s::%s: Connected after retrying.\n", driverName, functionName);
   }
   asynPrint(pself->pasynUserSelf, ASYN_TRACEIO_DRIVER,
     "%s::%s: Connected to broker\n", driverName, functionName);
-  // subscribe to topics in  I/O Intr records
-  auto vars = pself->getInterruptVariables();
-  for (auto itr = vars.begin(); itr != vars.end(); itr++) {
-    auto& deviceVar = *static_cast<MqttTopicVariable*>(*itr);
-    MqttTopicAddr const& addr = static_cast<MqttTopicAddr const&>(deviceVar.address());
-    pself->mqttClient.subscribe(addr.topicName);
+  pself->trace.record(MqttTrace::EV_CONNECT, reason);
+  pself->lock();
+  pself->connected = true;
+  StartupStats& stats = pself->startup;
+  if (stats.connects++ == 0 && stats.initNs != 0) stats.connectNs = epicsMonotonicGet() - stats.initNs;
+  bool resumed = pself->mqttClient->sessionPresent();
+  pself->unlock();
+  /*
+    A resumed session keeps the queued messages, but only the subscriptions of
+    the previous connection: lazy topics, bindings and image topics may have
+    changed since. All topics are subscribed again, asking the broker to send
+    retained messages only for the new ones, so the reconnect does not replay
+    every retained value.
+  */
+  if (resumed) {
+    asynPrint(pself->pasynUserSelf, ASYN_TRACEIO_DRIVER,
+      "%s::%s: Session resumed, renewing subscriptions\n", driverName, functionName);
+  }
+  // subscribe to topics in I/O Intr records, once per topic and in a single request
+  epicsUInt64 start = epicsMonotonicGet();
+  std::vector<std::string> topics;
+  std::unordered_set<std::string> seen;
+  pself->lock();
+  if (pself->options.lazySubscribe) {
+    // only topics with demand; idle ones were dropped with the old session
+    for (auto& entry : pself->lazyTopics) {
+      entry.second.subscribed = entry.second.demand > 0;
+      if (entry.second.subscribed && seen.insert(entry.first).second)
+        topics.push_back(entry.first);
+    }
+  }
+  else {
+    auto vars = pself->getInterruptVariables();
+    topics.reserve(vars.size());
+    seen.reserve(vars.size());
+    for (auto itr = vars.begin(); itr != vars.end(); itr++) {
+      auto& deviceVar = *static_cast<MqttTopicVariable*>(*itr);
+      MqttTopicAddr const& addr = static_cast<MqttTopicAddr const&>(deviceVar.address());
+      if (seen.insert(addr.topic.name()).second)
+        topics.push_back(addr.topic.name());
+    }
+  }
+  for (const auto& binding : pself->topicBindings) {
+    if (seen.insert(binding.first).second)
+      topics.push_back(binding.first);
+  }
+  if (pself->imageServer) {
+    for (const auto& topic : pself->imageServer->topics()) {
+      if (seen.insert(topic).second)
+        topics.push_back(topic);
+    }
+  }
+  if (pself->warmingUp) {
+    pself->warmPendingTopics = seen;
+    pself->warmTopicCount = seen.size();
+    if (seen.empty()) epicsEventSignal(pself->warmDoneEvent);
   }
+  pself->unlock();
+  if (resumed) pself->mqttClient->resubscribe(topics);
+  else pself->mqttClient->subscribe(topics);
+
+  epicsUInt64 end = epicsMonotonicGet();
+  pself->lock();
+  stats.subscribeNs = end - start;
+  stats.subscribedTopics = topics.size();
+  pself->unlock();
 }
 
 void MqttDriver::onDisconnectCb(Autoparam::Driver* driver, const std::string& reason) {
@@ -218,121 +668,969 @@ void MqttDriver::onDisconnectCb(Autoparam::Driver* driver, const std::string& re
   const char* functionName = __FUNCTION__;
   asynPrint(pself->pasynUserSelf, ASYN_TRACE_ERROR,
     "%s::%s: Connection lost. Reconnecting...\n", driverName, functionName);
-  pself->mqttClient.reconnect();
+  pself->trace.record(MqttTrace::EV_DISCONNECT, reason);
+  pself->lock();
+  pself->connected = false;
+  pself->unlock();
+  pself->mqttClient->reconnect();
 }
 
+/*
+  Subscribe/publish/message callbacks run once per event, so they only touch
+  the lock-free counters and trace buffer. Use mqttTraceDump to inspect them.
+*/
 void MqttDriver::onSubscribeCb(Autoparam::Driver* driver, const std::string& topic) {
   auto* pself = static_cast<MqttDriver*>(driver);
-  const char* functionName = __FUNCTION__;
-  asynPrint(pself->pasynUserSelf, ASYN_TRACEIO_DRIVER,
-    "%s::%s: Subscribed to topic '%s'\n", driverName, functionName, topic.c_str());
+  pself->trace.counters.subscribed.fetch_add(1, std::memory_order_relaxed);
+  pself->trace.record(MqttTrace::EV_SUBSCRIBE, topic);
 }
 
 void MqttDriver::onFailCb(Autoparam::Driver* driver, const std::string& errMsg) {
   auto* pself = static_cast<MqttDriver*>(driver);
   const char* functionName = __FUNCTION__;
-  asynPrint(pself->pasynUserSelf, ASYN_TRACE_ERROR,
-    "%s::%s: MQTT Operation error: '%s'\n", driverName, functionName, errMsg.c_str());
+  epicsUInt64 suppressed;
+  pself->trace.counters.opFailures.fetch_add(1, std::memory_order_relaxed);
+  pself->trace.record(MqttTrace::EV_OP_FAILURE, errMsg);
+  if (pself->opFailLimiter.allow(suppressed)) {
+    asynPrint(pself->pasynUserSelf, ASYN_TRACE_ERROR,
+      "%s::%s: MQTT Operation error: '%s' (%llu similar errors suppressed)\n",
+      driverName, functionName, errMsg.c_str(), (unsigned long long)suppressed);
+  }
 }
 
 void MqttDriver::onPublishCb(Autoparam::Driver* driver, const std::string& topic) {
   auto* pself = static_cast<MqttDriver*>(driver);
-  const char* functionName = __FUNCTION__;
-  asynPrint(pself->pasynUserSelf, ASYN_TRACEIO_DRIVER,
-    "%s::%s: Published to topic '%s'\n", driverName, functionName, topic.c_str());
+  pself->trace.counters.published.fetch_add(1, std::memory_order_relaxed);
+  pself->trace.record(MqttTrace::EV_PUBLISH, topic);
+}
+
+template <typename epicsDataType>
+static epicsDataType checkedInteger(epicsInt64 value) {
+  if (value < static_cast<epicsInt64>(std::numeric_limits<epicsDataType>::min())
+    || value > static_cast<epicsInt64>(std::numeric_limits<epicsDataType>::max()))
+    throw std::out_of_range("Integer out of range");
+  return static_cast<epicsDataType>(value);
+}
+
+/* Number read from a JSON-like document as a record value, see mqttJsonNumberAs */
+template <typename epicsDataType>
+static epicsDataType jsonNumberAs(const MqttJsonNumber& number) {
+  epicsDataType value;
+  const char* error = mqttJsonNumberAs(number, value);
+  if (error) throw std::invalid_argument(error);
+  return value;
 }
 
 void MqttDriver::onMessageCb(Autoparam::Driver* driver, const std::string& topic, const std::string& payload) {
   auto* pself = static_cast<MqttDriver*>(driver);
   const char* functionName = __FUNCTION__;
-  std::string val = payload;
-  pself->lock();
-  auto vars = pself->getInterruptVariables();
-  for (auto itr = vars.begin(); itr != vars.end(); itr++) {
-    auto& deviceVar = *static_cast<MqttTopicVariable*>(*itr);
-    MqttTopicAddr const& addr = static_cast<MqttTopicAddr const&>(deviceVar.address());
-    if (addr.topicName != topic)
-      continue;
-    if (addr.format == MqttTopicAddr::JSON) {
-      try {
-        json root = json::parse(payload);
-        const json* fieldAddr = findJsonField(root, addr.jsonField);
-        if (!fieldAddr || fieldAddr->is_null())
-          throw std::invalid_argument("JSON field not found: " + addr.jsonField);
-        if (fieldAddr->is_string())
-          val = fieldAddr->get<std::string>();
-        else
-          val = fieldAddr->dump();
+  epicsUInt64 suppressed;
+  pself->trace.counters.messages.fetch_add(1, std::memory_order_relaxed);
+  pself->trace.counters.bytes.fetch_add(payload.size(), std::memory_order_relaxed);
+  pself->trace.record(MqttTrace::EV_MESSAGE, topic, payload.size());
+  if (pself->imageServer) {
+    // image topics go straight to their PVA channel, not to records
+    try {
+      if (pself->imageServer->post(topic, payload)) {
+        pself->lock();
+        if (pself->warmingUp && pself->warmPendingTopics.erase(topic) && pself->warmPendingTopics.empty())
+          epicsEventSignal(pself->warmDoneEvent);
+        pself->unlock();
+        return;
       }
-      catch (const std::exception& e) {
+    }
+    catch (const std::exception& e) {
+      pself->trace.counters.parseErrors.fetch_add(1, std::memory_order_relaxed);
+      pself->trace.record(MqttTrace::EV_PARSE_ERROR, topic, payload.size());
+      if (pself->parseErrorLimiter.allow(suppressed)) {
         asynPrint(pself->pasynUserSelf, ASYN_TRACE_ERROR,
-          "%s::%s: Failed to parse JSON payload for topic '%s', field '%s': %s\n",
-          driverName, functionName, topic.c_str(), addr.jsonField.c_str(), e.what());
-        continue;
+          "%s::%s: Invalid image frame on topic '%s': %s (%llu similar errors suppressed)\n",
+          driverName, functionName, topic.c_str(), e.what(), (unsigned long long)suppressed);
       }
+      return;
     }
-    int index = deviceVar.asynIndex();
+  }
+  // the Sparkplug tables only change at record initialization, so checking for SPB records needs no lock
+  MqttSparkplugTopic sparkplugTopic;
+  if (!pself->sparkplugDevices.empty() && MqttSparkplugTopic::parse(topic, sparkplugTopic)) {
+    pself->lock();
     try {
-      switch (deviceVar.asynType()) {
-        case asynParamInt32:
-          if (isBoolean(val)) {
-            pself->setParam(deviceVar, static_cast<epicsInt32>(val == "true"), asynSuccess);
-            break;
+      pself->dispatchSparkplug(sparkplugTopic, payload);
+    }
+    catch (const std::exception& e) {
+      pself->trace.counters.parseErrors.fetch_add(1, std::memory_order_relaxed);
+      pself->trace.record(MqttTrace::EV_PARSE_ERROR, topic, payload.size());
+      if (pself->parseErrorLimiter.allow(suppressed)) {
+        asynPrint(pself->pasynUserSelf, ASYN_TRACE_ERROR,
+          "%s::%s: Invalid Sparkplug payload on topic '%s': %s (%llu similar errors suppressed)\n",
+          driverName, functionName, topic.c_str(), e.what(), (unsigned long long)suppressed);
+      }
+    }
+    pself->callParamCallbacks();
+    if (pself->warmingUp) {
+      std::string& filter = pself->sparkplugFilter;
+      filter.assign("spBv1.0/").append(sparkplugTopic.group).append("/+/").append(sparkplugTopic.edgeNode).append("/#");
+      if (pself->warmPendingTopics.erase(filter) && pself->warmPendingTopics.empty())
+        epicsEventSignal(pself->warmDoneEvent);
+    }
+    pself->unlock();
+    return;
+  }
+  pself->lock();
+  // bound broker topics are delivered to the records of their record topic
+  auto binding = pself->topicBindings.find(topic);
+  const std::string& route = binding == pself->topicBindings.end() ? topic : binding->second;
+  MqttCodec decodedCodec = MQTT_CODEC_NONE; // codec of the payload held in decodeBuffer
+  const MqttJsonExtractor* extracted = nullptr; // extractor already run on this message
+  std::string extractError;
+  auto records = pself->topicRecords.find(route);
+  if (records != pself->topicRecords.end()) {
+    for (TopicRecord& record : records->second) {
+      if (record.interrupts <= 0 || !record.update) continue; // not scanned I/O Intr
+      MqttTopicVariable& deviceVar = *record.var;
+      MqttTopicAddr const& addr = static_cast<MqttTopicAddr const&>(deviceVar.address());
+      // compressed payloads are decoded once per message into the reusable buffer
+      const std::string* raw = &payload;
+      if (record.codec != MQTT_CODEC_NONE) {
+        try {
+          if (decodedCodec != record.codec) {
+            decodedCodec = MQTT_CODEC_NONE;
+            mqttDecompress(record.codec, payload, pself->decodeBuffer);
+            decodedCodec = record.codec;
           }
-          if (!isInteger(val)) throw std::invalid_argument("Invalid integer");
-          pself->setParam(deviceVar, std::stoi(val), asynSuccess);
-          break;
-        case asynParamFloat64:
-          if (!isFloat(val)) throw std::invalid_argument("Invalid float");
-          pself->setParam(deviceVar, std::stod(val), asynSuccess);
-          break;
-        case asynParamUInt32Digital:
-          if (isBoolean(val)) {
-            pself->setParam(deviceVar, static_cast<epicsUInt32>(val == "true"), asynSuccess);
-            break;
+        }
+        catch (const std::exception& e) {
+          pself->trace.counters.parseErrors.fetch_add(1, std::memory_order_relaxed);
+          pself->trace.record(MqttTrace::EV_PARSE_ERROR, topic, payload.size());
+          if (pself->parseErrorLimiter.allow(suppressed)) {
+            asynPrint(pself->pasynUserSelf, ASYN_TRACE_ERROR,
+              "%s::%s: Failed to decompress %s payload for topic '%s': %s (%llu similar errors suppressed)\n",
+              driverName, functionName, mqttCodecName(record.codec), topic.c_str(), e.what(),
+              (unsigned long long)suppressed);
           }
-          if (!isInteger(val, false)) throw std::invalid_argument("Invalid unsigned integer");
-          pself->setParam(deviceVar, static_cast<epicsUInt32>(std::stoul(val)), asynSuccess);
-          break;
-        case asynParamOctet:
-          // use asyn directly - setParam octet overload is not defined in runtime. TODO: investigate
-          pself->setStringParam(index, val.c_str());
-          break;
-        case asynParamInt32Array:
-        {
-          std::vector<epicsInt32> auxArray;
-          asynStatus parseStatus = checkAndParseIntArray(val, auxArray);
-          Autoparam::Array<epicsInt32> dataArray(auxArray.data(), auxArray.size());
-          if (parseStatus == asynSuccess) {
-            pself->doCallbacksArray(deviceVar, dataArray, asynSuccess);
+          continue;
+        }
+        raw = &pself->decodeBuffer;
+      }
+      FieldValue value;
+      value.text = raw;
+      if (record.extractor) {
+        try {
+          // the first record of the topic extracts the fields of all of them
+          if (extracted != record.extractor) {
+            extractError.clear();
+            extracted = record.extractor;
+            try {
+              record.extractor->extract(*raw);
+            }
+            catch (const std::exception& e) {
+              extractError = e.what();
+            }
+          }
+          if (!extractError.empty()) throw std::invalid_argument(extractError);
+          // numbers are converted without text; strings, booleans and containers are parsed like FLAT payloads
+          bool hasElements = record.extractor->elements(record.slot, value.elements, value.count);
+          if (record.numeric) value.number = record.extractor->number(record.slot);
+          if (!hasElements && !value.number) {
+            value.text = record.extractor->value(record.slot);
+            if (!value.text) throw std::invalid_argument("JSON field not found: " + addr.jsonField);
           }
-          else throw std::invalid_argument("Failed parsing integer array");
-          break;
         }
-        case asynParamFloat64Array:
-        {
-          std::vector<epicsFloat64> auxArray;
-          asynStatus parseStatus = checkAndParseFloatArray(val, auxArray);
-          Autoparam::Array<epicsFloat64> dataArray(auxArray.data(), auxArray.size());
-          if (parseStatus == asynSuccess) {
-            pself->doCallbacksArray(deviceVar, dataArray, asynSuccess);
+        catch (const std::exception& e) {
+          pself->trace.counters.parseErrors.fetch_add(1, std::memory_order_relaxed);
+          pself->trace.record(MqttTrace::EV_PARSE_ERROR, topic, payload.size());
+          if (pself->parseErrorLimiter.allow(suppressed)) {
+            asynPrint(pself->pasynUserSelf, ASYN_TRACE_ERROR,
+              "%s::%s: Failed to parse %s payload for topic '%s', field '%s': %s (%llu similar errors suppressed)\n",
+              driverName, functionName, formatName(addr.format), topic.c_str(), addr.jsonField.c_str(), e.what(),
+              (unsigned long long)suppressed);
           }
-          else throw std::invalid_argument("Failed parsing float array");
-          break;
+          continue;
+        }
+      }
+      try {
+        (pself->*record.update)(deviceVar, value);
+      }
+      catch (const std::exception& e) {
+        pself->trace.counters.parseErrors.fetch_add(1, std::memory_order_relaxed);
+        pself->trace.record(MqttTrace::EV_PARSE_ERROR, topic, payload.size());
+        if (pself->parseErrorLimiter.allow(suppressed)) {
+          asynPrint(pself->pasynUserSelf, ASYN_TRACE_ERROR,
+            "%s::%s:%s: Unexpected value received for topic: '%s': %s) (%llu similar errors suppressed)\n",
+            driverName, functionName, e.what(), addr.topic.name().c_str(), payload.c_str(), (unsigned long long)suppressed);
         }
-        default:
-          break;
       }
-    }
-    catch (const std::exception& e) {
-      asynPrint(pself->pasynUserSelf, ASYN_TRACE_ERROR,
-        "%s::%s:%s: Unexpected value received for topic: '%s': %s)\n",
-        driverName, functionName, e.what(), addr.topicName.c_str(), payload.c_str());
     }
   }
   pself->callParamCallbacks();
+  // warm start waits for the broker topics, not the record topics they are bound to
+  if (pself->warmingUp && pself->warmPendingTopics.erase(topic) && pself->warmPendingTopics.empty())
+    epicsEventSignal(pself->warmDoneEvent);
   pself->unlock();
 }
+
+//#############################################################################################
+// Record updates, one per record type; selected at record initialization, see updaterFor
+
+void MqttDriver::updateInt32(MqttTopicVariable& deviceVar, const FieldValue& field) {
+  epicsInt32 value;
+  if (field.number) value = jsonNumberAs<epicsInt32>(*field.number);
+  else if (isBoolean(*field.text)) value = static_cast<epicsInt32>(*field.text == "true");
+  else if (isInteger(*field.text)) value = std::stoi(*field.text);
+  else throw std::invalid_argument("Invalid integer");
+  setParam(deviceVar, value, asynSuccess);
+  keepSnapshot(deviceVar, &value, sizeof(value));
+}
+
+void MqttDriver::updateInt64(MqttTopicVariable& deviceVar, const FieldValue& field) {
+  epicsInt64 value;
+  if (field.number) value = jsonNumberAs<epicsInt64>(*field.number);
+  else if (isBoolean(*field.text)) value = static_cast<epicsInt64>(*field.text == "true");
+  else if (isInteger(*field.text)) value = std::stoll(*field.text); // throws std::out_of_range on overflow
+  else throw std::invalid_argument("Invalid integer");
+  setParam(deviceVar, value, asynSuccess);
+  keepSnapshot(deviceVar, &value, sizeof(value));
+}
+
+void MqttDriver::updateFloat64(MqttTopicVariable& deviceVar, const FieldValue& field) {
+  epicsFloat64 value;
+  if (field.number) value = jsonNumberAs<epicsFloat64>(*field.number);
+  else if (isFloat(*field.text)) value = std::stod(*field.text);
+  else throw std::invalid_argument("Invalid float");
+  setParam(deviceVar, value, asynSuccess);
+  keepSnapshot(deviceVar, &value, sizeof(value));
+}
+
+void MqttDriver::updateDigital(MqttTopicVariable& deviceVar, const FieldValue& field) {
+  epicsUInt32 value;
+  if (field.number) {
+    // same rules as the text: no sign or fraction, wider values truncated like std::stoul
+    const MqttJsonNumber& number = *field.number;
+    if (number.kind == MqttJsonNumber::FLOAT || (number.kind == MqttJsonNumber::INTEGER && number.integer < 0))
+      throw std::invalid_argument("Invalid unsigned integer");
+    value = static_cast<epicsUInt32>(number.kind == MqttJsonNumber::UNSIGNED ? number.uinteger : number.integer);
+  }
+  else if (isBoolean(*field.text)) value = static_cast<epicsUInt32>(*field.text == "true");
+  else if (isInteger(*field.text, false)) value = static_cast<epicsUInt32>(std::stoul(*field.text));
+  else throw std::invalid_argument("Invalid unsigned integer");
+  setParam(deviceVar, value, asynSuccess);
+  keepSnapshot(deviceVar, &value, sizeof(value));
+}
+
+void MqttDriver::updateString(MqttTopicVariable& deviceVar, const FieldValue& field) {
+  int index = deviceVar.asynIndex();
+  // use asyn directly - setParam octet overload is not defined in runtime. TODO: investigate
+  setStringParam(index, field.text->c_str());
+  if (deviceVar.stale) {
+    setParamAlarmStatus(index, epicsAlarmNone);
+    setParamAlarmSeverity(index, epicsSevNone);
+  }
+  keepSnapshot(deviceVar, field.text->data(), field.text->size());
+}
+
+/*
+  Parses an array payload (text for FLAT/JSON, packed binary for BIN), or
+  converts the numbers of a JSON-like array, and posts it to the variable.
+*/
+template <typename epicsDataType>
+void MqttDriver::updateArray(MqttTopicVariable& deviceVar, const FieldValue& field) {
+  MqttTopicAddr const& addr = static_cast<MqttTopicAddr const&>(deviceVar.address());
+  if (field.elements) {
+    // already in the record type, posted from the extractor buffer (only read by the callbacks)
+    epicsDataType* data = const_cast<epicsDataType*>(static_cast<const epicsDataType*>(field.elements));
+    Autoparam::Array<epicsDataType> dataArray(data, field.count);
+    doCallbacksArray(deviceVar, dataArray, asynSuccess);
+    keepSnapshot(deviceVar, data, field.count * sizeof(epicsDataType));
+    return;
+  }
+  std::vector<epicsDataType> auxArray;
+  asynStatus parseStatus = addr.format == MqttTopicAddr::BIN ? decodeBinaryArray(*field.text, auxArray)
+    : checkAndParseArray(*field.text, auxArray);
+  if (parseStatus != asynSuccess) throw std::invalid_argument("Failed parsing array");
+  Autoparam::Array<epicsDataType> dataArray(auxArray.data(), auxArray.size());
+  doCallbacksArray(deviceVar, dataArray, asynSuccess);
+  keepSnapshot(deviceVar, auxArray.data(), auxArray.size() * sizeof(epicsDataType));
+}
+
+/* Element type document array paths are converted into for a record type */
+MqttJsonExtractor::ElementType MqttDriver::elementTypeFor(asynParamType type) {
+  switch (type) {
+    case asynParamInt8Array: return MqttJsonExtractor::ELEMENT_INT8;
+    case asynParamInt16Array: return MqttJsonExtractor::ELEMENT_INT16;
+    case asynParamInt32Array: return MqttJsonExtractor::ELEMENT_INT32;
+    case asynParamInt64Array: return MqttJsonExtractor::ELEMENT_INT64;
+    case asynParamFloat32Array: return MqttJsonExtractor::ELEMENT_FLOAT32;
+    default: return MqttJsonExtractor::ELEMENT_FLOAT64;
+  }
+}
+
+/* Update of a record type, nullptr for types records cannot read */
+MqttDriver::Updater MqttDriver::updaterFor(asynParamType type) {
+  switch (type) {
+    case asynParamInt32: return &MqttDriver::updateInt32;
+    case asynParamInt64: return &MqttDriver::updateInt64;
+    case asynParamFloat64: return &MqttDriver::updateFloat64;
+    case asynParamUInt32Digital: return &MqttDriver::updateDigital;
+    case asynParamOctet: return &MqttDriver::updateString;
+    case asynParamInt8Array: return &MqttDriver::updateArray<epicsInt8>;
+    case asynParamInt16Array: return &MqttDriver::updateArray<epicsInt16>;
+    case asynParamInt32Array: return &MqttDriver::updateArray<epicsInt32>;
+    case asynParamInt64Array: return &MqttDriver::updateArray<epicsInt64>;
+    case asynParamFloat32Array: return &MqttDriver::updateArray<epicsFloat32>;
+    case asynParamFloat64Array: return &MqttDriver::updateArray<epicsFloat64>;
+    default: return nullptr;
+  }
+}
+
+//#############################################################################################
+// Sparkplug B
+
+/* bdSeq metric of an NBIRTH/NDEATH payload, which pairs the death certificate with its session */
+static bool readBdSeq(const std::string& payload, epicsUInt64& seq) {
+  MqttSparkplugReader reader(payload);
+  MqttSparkplugMetric metric;
+  while (reader.next(metric)) {
+    if (metric.name == "bdSeq" && metric.isNumeric()) {
+      seq = static_cast<epicsUInt64>(metric.toInt64());
+      return true;
+    }
+  }
+  return false;
+}
+
+/*
+  Routes the metrics of a Sparkplug B message to their records, in a single
+  pass over the payload. BIRTH messages (re)define the alias of each bound
+  metric and its datatype, which DATA messages usually omit. DEATH messages
+  put the records of the node/device in COMM/INVALID alarm until new data
+  arrives. Called with the driver locked; leaves the device key in sparkplugKey.
+*/
+void MqttDriver::dispatchSparkplug(const MqttSparkplugTopic& topic, const std::string& payload) {
+  const char* functionName = __FUNCTION__;
+  // devices are keyed by their topic with a wildcard on the message type, see parseTopicAddress
+  sparkplugKey.assign("spBv1.0/").append(topic.group).append("/+/").append(topic.edgeNode);
+  if (topic.type == MqttSparkplugTopic::NBIRTH) {
+    epicsUInt64 seq;
+    if (readBdSeq(payload, seq)) sparkplugBirthSeq[sparkplugKey] = seq;
+    else sparkplugBirthSeq.erase(sparkplugKey);
+  }
+  if (topic.type == MqttSparkplugTopic::NDEATH) {
+    // a late NDEATH of the previous session (its will message) must not kill the current one
+    epicsUInt64 seq;
+    auto birth = sparkplugBirthSeq.find(sparkplugKey);
+    if (birth != sparkplugBirthSeq.end() && readBdSeq(payload, seq) && seq != birth->second) return;
+    // the node and all of its devices are offline
+    for (auto& entry : sparkplugDevices) {
+      if (entry.first.compare(0, sparkplugKey.size(), sparkplugKey) == 0
+        && (entry.first.size() == sparkplugKey.size() || entry.first[sparkplugKey.size()] == '/'))
+        markSparkplugDead(entry.second);
+    }
+    return;
+  }
+  if (!topic.device.empty()) sparkplugKey.append("/").append(topic.device);
+  auto found = sparkplugDevices.find(sparkplugKey);
+  if (found == sparkplugDevices.end()) return;
+  SparkplugDevice& device = found->second;
+  if (topic.isDeath()) {
+    markSparkplugDead(device);
+    return;
+  }
+  if (!topic.isBirth() && !topic.isData()) return; // commands
+
+  bool birth = topic.isBirth();
+  if (birth) device.byAlias.clear();
+  epicsUInt64 suppressed;
+  MqttSparkplugReader reader(payload);
+  MqttSparkplugMetric metric;
+  while (reader.next(metric)) {
+    SparkplugMetric* entry = nullptr;
+    if (!metric.name.empty()) {
+      sparkplugName.assign(metric.name); // reused buffer, no allocation once grown
+      auto byName = device.byName.find(sparkplugName);
+      if (byName != device.byName.end()) entry = &byName->second;
+      if (birth && entry) {
+        entry->datatype = metric.datatype;
+        if (metric.hasAlias) device.byAlias[metric.alias] = entry;
+      }
+    }
+    else if (metric.hasAlias) {
+      auto byAlias = device.byAlias.find(metric.alias);
+      if (byAlias != device.byAlias.end()) entry = byAlias->second;
+    }
+    if (!entry || metric.isNull) continue;
+    if (!metric.datatype) metric.datatype = entry->datatype;
+    for (MqttTopicVariable* deviceVar : entry->vars) {
+      try {
+        updateSparkplugVar(*deviceVar, metric);
+      }
+      catch (const std::exception& e) {
+        trace.counters.parseErrors.fetch_add(1, std::memory_order_relaxed);
+        if (parseErrorLimiter.allow(suppressed)) {
+          asynPrint(pasynUserSelf, ASYN_TRACE_ERROR,
+            "%s::%s: Unexpected value for Sparkplug metric '%s' of '%s': %s (%llu similar errors suppressed)\n",
+            driverName, functionName, static_cast<MqttTopicAddr const&>(deviceVar->address()).jsonField.c_str(), sparkplugKey.c_str(), e.what(),
+            (unsigned long long)suppressed);
+        }
+      }
+    }
+  }
+}
+
+/* Converts a metric to the record type and posts it. Called with the driver locked; throws on mismatches. */
+void MqttDriver::updateSparkplugVar(MqttTopicVariable& deviceVar, const MqttSparkplugMetric& metric) {
+  int index = deviceVar.asynIndex();
+  switch (deviceVar.asynType()) {
+    case asynParamInt32:
+    {
+      epicsInt32 value = checkedInteger<epicsInt32>(metric.toInt64());
+      setParam(deviceVar, value, asynSuccess);
+      keepSnapshot(deviceVar, &value, sizeof(value));
+      break;
+    }
+    case asynParamInt64:
+    {
+      epicsInt64 value = metric.toInt64();
+      setParam(deviceVar, value, asynSuccess);
+      keepSnapshot(deviceVar, &value, sizeof(value));
+      break;
+    }
+    case asynParamFloat64:
+    {
+      epicsFloat64 value = metric.toDouble();
+      setParam(deviceVar, value, asynSuccess);
+      keepSnapshot(deviceVar, &value, sizeof(value));
+      break;
+    }
+    case asynParamUInt32Digital:
+    {
+      epicsUInt32 value = checkedInteger<epicsUInt32>(metric.toInt64());
+      setParam(deviceVar, value, asynSuccess);
+      keepSnapshot(deviceVar, &value, sizeof(value));
+      break;
+    }
+    case asynParamOctet:
+      if (metric.kind == MqttSparkplugMetric::STRING) sparkplugValue.assign(metric.bytes);
+      else if (metric.kind == MqttSparkplugMetric::FLOAT || metric.kind == MqttSparkplugMetric::DOUBLE)
+        sparkplugValue = std::to_string(metric.toDouble());
+      else sparkplugValue = std::to_string(metric.toInt64());
+      setStringParam(index, sparkplugValue.c_str());
+      if (deviceVar.stale) {
+        setParamAlarmStatus(index, epicsAlarmNone);
+        setParamAlarmSeverity(index, epicsSevNone);
+      }
+      keepSnapshot(deviceVar, sparkplugValue.data(), sparkplugValue.size());
+      break;
+    case asynParamInt8Array:
+      updateSparkplugArray<epicsInt8>(deviceVar, metric);
+      break;
+    case asynParamInt16Array:
+      updateSparkplugArray<epicsInt16>(deviceVar, metric);
+      break;
+    case asynParamInt32Array:
+      updateSparkplugArray<epicsInt32>(deviceVar, metric);
+      break;
+    case asynParamInt64Array:
+      updateSparkplugArray<epicsInt64>(deviceVar, metric);
+      break;
+    case asynParamFloat32Array:
+      updateSparkplugArray<epicsFloat32>(deviceVar, metric);
+      break;
+    case asynParamFloat64Array:
+      updateSparkplugArray<epicsFloat64>(deviceVar, metric);
+      break;
+    default:
+      throw std::logic_error("Unsupported record type");
+  }
+}
+
+/* Converts a packed array metric into the reusable array buffer and posts it */
+template <typename epicsDataType>
+void MqttDriver::updateSparkplugArray(MqttTopicVariable& deviceVar, const MqttSparkplugMetric& metric) {
+  if (!metric.arrayElementSize()) throw std::invalid_argument("Not a supported array metric");
+  size_t count = metric.arrayLength();
+  // 8-byte elements keep the buffer aligned for every record type
+  sparkplugArray.resize((count * sizeof(epicsDataType) + sizeof(epicsInt64) - 1) / sizeof(epicsInt64));
+  epicsDataType* data = reinterpret_cast<epicsDataType*>(sparkplugArray.data());
+  for (size_t i = 0; i < count; i++) {
+    if (std::is_floating_point<epicsDataType>::value) data[i] = static_cast<epicsDataType>(metric.arrayDouble(i));
+    else data[i] = checkedInteger<epicsDataType>(metric.arrayInt64(i));
+  }
+  Autoparam::Array<epicsDataType> dataArray(data, count);
+  doCallbacksArray(deviceVar, dataArray, asynSuccess);
+  keepSnapshot(deviceVar, data, count * sizeof(epicsDataType));
+}
+
+/* Puts the scalar records of a node/device that went offline in COMM/INVALID alarm */
+void MqttDriver::markSparkplugDead(SparkplugDevice& device) {
+  device.byAlias.clear(); // aliases are redefined by the next BIRTH
+  for (auto& entry : device.byName) {
+    for (MqttTopicVariable* deviceVar : entry.second.vars) {
+      asynParamType type = deviceVar->asynType();
+      bool scalar = type == asynParamInt32 || type == asynParamInt64 || type == asynParamFloat64
+        || type == asynParamUInt32Digital || type == asynParamOctet;
+      if (!scalar) continue; // array alarms are only posted with data
+      setParamAlarmStatus(deviceVar->asynIndex(), epicsAlarmComm);
+      setParamAlarmSeverity(deviceVar->asynIndex(), epicsSevInvalid);
+      deviceVar->stale = true;
+    }
+  }
+}
+
+//#############################################################################################
+// Lazy subscription
+
+/*
+  Called by autoparam when an I/O Intr interrupt is registered on a variable
+  (record scanned I/O Intr) or cancelled (SCAN changed away from I/O Intr).
+  The count kept in the record's topic binding decides whether onMessageCb
+  delivers to it. In lazy mode the first registration on a topic subscribes
+  to it; the last cancellation only starts the idle timer, see lazyTask.
+*/
+asynStatus MqttDriver::interruptRegistrar(DeviceVariable& deviceVar, bool cancel) {
+  auto& topicVar = static_cast<MqttTopicVariable&>(deviceVar);
+  auto* pself = topicVar.driver;
+  const char* functionName = __FUNCTION__;
+  MqttTopicAddr const& addr = static_cast<MqttTopicAddr const&>(deviceVar.address());
+  bool subscribe = false;
+  pself->lock();
+  // only records scanned I/O Intr receive messages
+  if (addr.format != MqttTopicAddr::SPB) {
+    int& interrupts = pself->topicRecords[addr.topic.name()][topicVar.topicRecord].interrupts;
+    if (cancel) {
+      if (interrupts > 0) interrupts--;
+    }
+    else interrupts++;
+  }
+  if (!pself->options.lazySubscribe) {
+    pself->unlock();
+    return asynSuccess;
+  }
+  LazyTopic& entry = pself->lazyTopics[addr.topic.name()];
+  if (cancel) {
+    if (entry.demand > 0 && --entry.demand == 0) entry.idleSinceNs = epicsMonotonicGet();
+  }
+  else if (entry.demand++ == 0 && !entry.subscribed && pself->connected) {
+    entry.subscribed = subscribe = true;
+  }
+  pself->unlock();
+  if (subscribe) {
+    try {
+      pself->mqttClient->subscribe(addr.topic.name());
+    }
+    catch (const std::exception& e) {
+      asynPrint(pself->pasynUserSelf, ASYN_TRACE_ERROR, "%s::%s: Failed subscribing to '%s': %s\n",
+        driverName, functionName, addr.topic.name().c_str(), e.what());
+      pself->lock();
+      pself->lazyTopics[addr.topic.name()].subscribed = false;
+      pself->unlock();
+    }
+  }
+  return asynSuccess;
+}
+
+/* Unsubscribes lazy topics that had no demand for lazyIdleTimeout seconds */
+void MqttDriver::lazyTask(void* arg) {
+  auto* pself = static_cast<MqttDriver*>(arg);
+  const char* functionName = __FUNCTION__;
+  const epicsUInt64 timeoutNs = static_cast<epicsUInt64>(pself->options.lazyIdleTimeout * 1e9);
+  double period = pself->options.lazyIdleTimeout / 4;
+  if (period < 0.1) period = 0.1;
+  if (period > 5) period = 5;
+  while (epicsEventWaitWithTimeout(pself->lazyStopEvent, period) == epicsEventWaitTimeout) {
+    std::vector<std::string> idle;
+    epicsUInt64 now = epicsMonotonicGet();
+    pself->lock();
+    for (auto& entry : pself->lazyTopics) {
+      LazyTopic& topic = entry.second;
+      if (topic.demand == 0 && topic.subscribed && now - topic.idleSinceNs >= timeoutNs) {
+        topic.subscribed = false;
+        idle.push_back(entry.first);
+      }
+    }
+    bool connected = pself->connected;
+    pself->unlock();
+    if (!connected) continue;
+    for (const auto& topic : idle) {
+      try {
+        pself->mqttClient->unsubscribe(topic);
+        pself->trace.record(MqttTrace::EV_UNSUBSCRIBE, topic);
+      }
+      catch (const std::exception& e) {
+        asynPrint(pself->pasynUserSelf, ASYN_TRACE_ERROR, "%s::%s: Failed unsubscribing from '%s': %s\n",
+          driverName, functionName, topic.c_str(), e.what());
+      }
+    }
+  }
+  epicsEventSignal(pself->lazyDoneEvent);
+}
+
+/* Stops lazyTask and waits until it returned, so it no longer uses the client */
+void MqttDriver::stopLazyTask() {
+  if (!lazyRunning) return;
+  lazyRunning = false;
+  epicsEventSignal(lazyStopEvent);
+  epicsEventMustWait(lazyDoneEvent);
+}
+
+//#############################################################################################
+// Runtime topic bindings
+
+void MqttDriver::bindTopic(const std::string& brokerTopic, const std::string& recordTopic) {
+  if (!isValidTopicName(brokerTopic)) throw std::invalid_argument("Invalid topic name: " + brokerTopic);
+  if (!isValidTopicName(recordTopic)) throw std::invalid_argument("Invalid topic name: " + recordTopic);
+  applyBindings([&](TopicBindings& bindings) {
+    bindings[brokerTopic] = recordTopic;
+    return true;
+    }, nullptr, nullptr);
+}
+
+bool MqttDriver::unbindTopic(const std::string& brokerTopic) {
+  return applyBindings([&](TopicBindings& bindings) {
+    return bindings.erase(brokerTopic) > 0;
+    }, nullptr, nullptr);
+}
+
+void MqttDriver::loadBindings(const std::string& path, size_t& added, size_t& removed) {
+  std::ifstream file(path);
+  if (!file) throw std::runtime_error("Cannot open bindings file '" + path + "'");
+  TopicBindings loaded;
+  std::string line;
+  for (size_t lineNo = 1; std::getline(file, line); lineNo++) {
+    line = line.substr(0, line.find('#'));
+    std::istringstream fields(line);
+    std::string brokerTopic, recordTopic, extra;
+    if (!(fields >> brokerTopic)) continue;
+    if (!(fields >> recordTopic) || (fields >> extra) || !isValidTopicName(brokerTopic) || !isValidTopicName(recordTopic))
+      throw std::invalid_argument(path + ":" + std::to_string(lineNo) + ": expected 'brokerTopic recordTopic'");
+    loaded[brokerTopic] = recordTopic;
+  }
+  applyBindings([&](TopicBindings& bindings) {
+    bindings.swap(loaded);
+    return true;
+    }, &added, &removed);
+}
+
+/*
+  Edits a copy of the binding table, installs it and sends SUBSCRIBE/UNSUBSCRIBE
+  requests for the broker topics that appeared/disappeared. Topics still used
+  directly by records are kept subscribed. The copy is made, edited and
+  installed in one lock hold, so concurrent edits do not lose each other.
+  Returns false, leaving the table untouched, if edit returns false.
+*/
+bool MqttDriver::applyBindings(const std::function<bool(TopicBindings&)>& edit, size_t* added, size_t* removed) {
+  const char* functionName = __FUNCTION__;
+  std::vector<std::string> toSubscribe, toUnsubscribe;
+  lock();
+  TopicBindings bindings = topicBindings;
+  if (!edit(bindings)) {
+    unlock();
+    return false;
+  }
+  std::unordered_set<std::string> recordTopics;
+  auto vars = getInterruptVariables();
+  for (auto itr = vars.begin(); itr != vars.end(); itr++) {
+    MqttTopicAddr const& addr = static_cast<MqttTopicAddr const&>((*itr)->address());
+    recordTopics.insert(addr.topic.name());
+  }
+  for (const auto& binding : topicBindings) {
+    if (!bindings.count(binding.first) && !recordTopics.count(binding.first))
+      toUnsubscribe.push_back(binding.first);
+  }
+  for (const auto& binding : bindings) {
+    if (!topicBindings.count(binding.first) && !recordTopics.count(binding.first))
+      toSubscribe.push_back(binding.first);
+  }
+  if (added) *added = toSubscribe.size();
+  if (removed) *removed = toUnsubscribe.size();
+  topicBindings.swap(bindings);
+  bool isConnected = connected;
+  unlock();
+
+  // while disconnected the new table is picked up by onConnectCb
+  if (!isConnected) return true;
+  try {
+    mqttClient->subscribe(toSubscribe);
+    for (const auto& topic : toUnsubscribe) {
+      mqttClient->unsubscribe(topic);
+      trace.record(MqttTrace::EV_UNSUBSCRIBE, topic);
+    }
+  }
+  catch (const std::exception& e) {
+    asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s::%s: Failed updating subscriptions: %s\n",
+      driverName, functionName, e.what());
+  }
+  return true;
+}
+
+void MqttDriver::bindingsReport(FILE* fp) {
+  lock();
+  std::vector<std::pair<std::string, std::string>> bindings(topicBindings.begin(), topicBindings.end());
+  unlock();
+  std::sort(bindings.begin(), bindings.end());
+  fprintf(fp, "%s: port '%s', %zu topic bindings\n", driverName, portName, bindings.size());
+  for (const auto& binding : bindings)
+    fprintf(fp, "  %s -> %s\n", binding.first.c_str(), binding.second.c_str());
+}
+
+//#############################################################################################
+// Image topics
+
+void MqttDriver::addImage(const std::string& pvName, const std::string& topic) {
+  if (started) throw std::logic_error("Image topics must be configured before iocInit");
+  if (!isValidTopicName(topic)) throw std::invalid_argument("Invalid topic name: " + topic);
+  if (pvName.empty()) throw std::invalid_argument("Empty PV name");
+  // the table is read-only after iocInit, so the message callback reads it unlocked
+  if (!imageServer) imageServer.reset(new MqttImageServer(std::string("mqttImage:") + portName));
+  imageServer->addImage(pvName, topic);
+}
+
+//#############################################################################################
+// Last-value snapshot
+
+/* Identifies a device variable across IOC restarts: "FUNCTION topic [field]" */
+std::string MqttDriver::snapshotKey(const MqttTopicVariable& deviceVar) {
+  MqttTopicAddr const& addr = static_cast<MqttTopicAddr const&>(deviceVar.address());
+  const MqttTopic& topic = addr.format == MqttTopicAddr::SPB ? addr.sparkplugDevice : addr.topic;
+  std::string key = deviceVar.function() + " " + topic.name();
+  if (addr.isDocument() || addr.format == MqttTopicAddr::SPB) key += " " + addr.jsonField;
+  return key;
+}
+
+/* Stores the last decoded value of a variable. Called with the driver locked. */
+void MqttDriver::keepSnapshot(MqttTopicVariable& deviceVar, const void* data, size_t size) {
+  deviceVar.stale = false;
+  if (options.snapshotFile.empty()) return;
+  deviceVar.snapshotValue.assign(static_cast<const char*>(data), size);
+  deviceVar.hasSnapshot = true;
+  snapshotDirty = true;
+}
+
+/*
+  Restores the values saved in the snapshot file. Restored values are set
+  with the configured alarm severity (UDF status) until a fresh message
+  arrives for their topic.
+*/
+void MqttDriver::loadSnapshot() {
+  const char* functionName = __FUNCTION__;
+  std::vector<MqttSnapshotEntry> entries;
+  try {
+    entries = MqttSnapshot::read(options.snapshotFile);
+  }
+  catch (const std::exception& e) {
+    asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s::%s: %s\n", driverName, functionName, e.what());
+    return;
+  }
+  std::unordered_map<std::string, const MqttSnapshotEntry*> byKey;
+  for (const auto& entry : entries) byKey[entry.key] = &entry;
+
+  size_t restored = 0;
+  const int status = epicsAlarmUDF;
+  const int severity = options.snapshotSeverity;
+  lock();
+  auto vars = getInterruptVariables();
+  for (auto itr = vars.begin(); itr != vars.end(); itr++) {
+    auto& deviceVar = *static_cast<MqttTopicVariable*>(*itr);
+    auto found = byKey.find(snapshotKey(deviceVar));
+    if (found == byKey.end() || found->second->type != deviceVar.asynType()) continue;
+    const std::string& value = found->second->value;
+    switch (deviceVar.asynType()) {
+      case asynParamInt32:
+      {
+        epicsInt32 v;
+        if (value.size() != sizeof(v)) continue;
+        memcpy(&v, value.data(), sizeof(v));
+        setParam(deviceVar, v, asynSuccess, status, severity);
+        break;
+      }
+      case asynParamInt64:
+      {
+        epicsInt64 v;
+        if (value.size() != sizeof(v)) continue;
+        memcpy(&v, value.data(), sizeof(v));
+        setParam(deviceVar, v, asynSuccess, status, severity);
+        break;
+      }
+      case asynParamFloat64:
+      {
+        epicsFloat64 v;
+        if (value.size() != sizeof(v)) continue;
+        memcpy(&v, value.data(), sizeof(v));
+        setParam(deviceVar, v, asynSuccess, status, severity);
+        break;
+      }
+      case asynParamUInt32Digital:
+      {
+        epicsUInt32 v;
+        if (value.size() != sizeof(v)) continue;
+        memcpy(&v, value.data(), sizeof(v));
+        setParam(deviceVar, v, asynSuccess, status, severity);
+        break;
+      }
+      case asynParamOctet:
+        setStringParam(deviceVar.asynIndex(), value.c_str());
+        setParamAlarmStatus(deviceVar.asynIndex(), status);
+        setParamAlarmSeverity(deviceVar.asynIndex(), severity);
+        break;
+      case asynParamInt8Array:
+        restoreArray<epicsInt8>(deviceVar, value, status, severity);
+        break;
+      case asynParamInt16Array:
+        restoreArray<epicsInt16>(deviceVar, value, status, severity);
+        break;
+      case asynParamInt32Array:
+        restoreArray<epicsInt32>(deviceVar, value, status, severity);
+        break;
+      case asynParamInt64Array:
+        restoreArray<epicsInt64>(deviceVar, value, status, severity);
+        break;
+      case asynParamFloat32Array:
+        restoreArray<epicsFloat32>(deviceVar, value, status, severity);
+        break;
+      case asynParamFloat64Array:
+        restoreArray<epicsFloat64>(deviceVar, value, status, severity);
+        break;
+      default:
+        continue;
+    }
+    deviceVar.snapshotValue = value;
+    deviceVar.hasSnapshot = true;
+    deviceVar.stale = true;
+    restored++;
+  }
+  callParamCallbacks();
+  unlock();
+  printf("%s: port '%s' restored %zu values from snapshot '%s'\n",
+    driverName, portName, restored, options.snapshotFile.c_str());
+}
+
+/* Copies a snapshot value into an aligned buffer and posts it as an array callback */
+template <typename epicsDataType>
+void MqttDriver::restoreArray(MqttTopicVariable& deviceVar, const std::string& value, int alarmStatus, int alarmSeverity) {
+  std::vector<epicsDataType> data(value.size() / sizeof(epicsDataType));
+  memcpy(data.data(), value.data(), data.size() * sizeof(epicsDataType));
+  Autoparam::Array<epicsDataType> dataArray(data.data(), data.size());
+  doCallbacksArray(deviceVar, dataArray, asynSuccess, alarmStatus, alarmSeverity);
+}
+
+void MqttDriver::writeSnapshot() {
+  const char* functionName = __FUNCTION__;
+  std::vector<MqttSnapshotEntry> entries;
+  lock();
+  if (!snapshotDirty) {
+    unlock();
+    return;
+  }
+  auto vars = getInterruptVariables();
+  for (auto itr = vars.begin(); itr != vars.end(); itr++) {
+    auto& deviceVar = *static_cast<MqttTopicVariable*>(*itr);
+    if (!deviceVar.hasSnapshot) continue;
+    MqttSnapshotEntry entry;
+    entry.key = snapshotKey(deviceVar);
+    entry.type = static_cast<uint8_t>(deviceVar.asynType());
+    entry.value = deviceVar.snapshotValue;
+    entries.push_back(std::move(entry));
+  }
+  snapshotDirty = false;
+  unlock();
+
+  try {
+    MqttSnapshot::write(options.snapshotFile, entries);
+  }
+  catch (const std::exception& e) {
+    // keep the values pending so the next period tries again
+    lock();
+    snapshotDirty = true;
+    unlock();
+    epicsUInt64 suppressed;
+    if (opFailLimiter.allow(suppressed))
+      asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s::%s: %s\n", driverName, functionName, e.what());
+  }
+}
+
+void MqttDriver::snapshotTask(void* arg) {
+  auto* pself = static_cast<MqttDriver*>(arg);
+  while (epicsEventWaitWithTimeout(pself->snapshotStopEvent, pself->options.snapshotPeriod) == epicsEventWaitTimeout) {
+    pself->writeSnapshot();
+  }
+  epicsEventSignal(pself->snapshotDoneEvent);
+}
+
+/* Stops snapshotTask and waits until it returned, so no periodic write is in progress */
+void MqttDriver::stopSnapshotTask() {
+  if (!snapshotRunning) return;
+  snapshotRunning = false;
+  epicsEventSignal(snapshotStopEvent);
+  epicsEventMustWait(snapshotDoneEvent);
+}
+
+/* Writes a final snapshot at IOC exit so the next start gets the latest values. The
+   periodic task is stopped first: both would write the same temporary file. */
+void MqttDriver::snapshotAtExit(void* arg) {
+  auto* pself = static_cast<MqttDriver*>(arg);
+  pself->stopSnapshotTask();
+  pself->writeSnapshot();
+}
+
+//#############################################################################################
+// Capture replay
+
+struct ReplayJob {
+  MqttDriver* driver;
+  std::string path;
+  double speed;
+  MqttCaptureReader reader;
+};
+
+void MqttDriver::replayCapture(const std::string& path, double speed) {
+  ReplayJob* job = new ReplayJob{ this, path, speed < 0 ? 0 : speed, {} };
+  try {
+    job->reader.open(path);
+  }
+  catch (...) {
+    delete job;
+    throw;
+  }
+  epicsThreadId tid = epicsThreadCreate("mqttReplay", epicsThreadPriorityMedium,
+    epicsThreadGetStackSize(epicsThreadStackMedium), replayTask, job);
+  if (!tid) {
+    delete job;
+    throw std::runtime_error("Cannot create the replay thread");
+  }
+}
+
+void MqttDriver::replayTask(void* arg) {
+  ReplayJob* job = static_cast<ReplayJob*>(arg);
+  MqttDriver* pself = job->driver;
+  const char* functionName = __FUNCTION__;
+  MqttCaptureRecord record;
+  epicsUInt64 count = 0, firstNs = 0;
+  double maxLag = 0;
+  epicsUInt64 start = epicsMonotonicGet();
+  try {
+    while (job->reader.next(record)) {
+      if (count == 0) firstNs = record.arrivalNs;
+      if (job->speed > 0) {
+        // schedule relative to the first record, scaled by the replay speed
+        double due = (record.arrivalNs - firstNs) * 1e-9 / job->speed;
+        double now = (epicsMonotonicGet() - start) * 1e-9;
+        if (due > now) epicsThreadSleep(due - now);
+        else if (now - due > maxLag) maxLag = now - due;
+      }
+      onMessageCb(pself, record.topic, record.payload);
+      count++;
+    }
+  }
+  catch (const std::exception& e) {
+    asynPrint(pself->pasynUserSelf, ASYN_TRACE_ERROR,
+      "%s::%s: Replay of '%s' aborted: %s\n", driverName, functionName, job->path.c_str(), e.what());
+  }
+  double elapsed = (epicsMonotonicGet() - start) * 1e-9;
+  printf("%s: replayed %llu messages from '%s' in %.3f s (%.0f msgs/s, max lag %.3f s)\n",
+    driverName, (unsigned long long)count, job->path.c_str(), elapsed,
+    elapsed > 0 ? count / elapsed : 0.0, maxLag);
+  delete job;
+}
+
 //#############################################################################################
 // Helper methods
 
@@ -358,15 +1656,58 @@ const json* MqttDriver::findJsonField(const json& payload, const std::string& ta
   return nullptr;
 }
 
+const char* MqttDriver::formatName(MqttTopicAddr::TopicFormat format) {
+  switch (format) {
+    case MqttTopicAddr::FLAT: return FLAT_FUNC_PREFIX;
+    case MqttTopicAddr::JSON: return JSON_FUNC_PREFIX;
+    case MqttTopicAddr::BIN: return BIN_FUNC_PREFIX;
+    case MqttTopicAddr::CBOR: return CBOR_FUNC_PREFIX;
+    case MqttTopicAddr::MSGPACK: return MSGPACK_FUNC_PREFIX;
+    case MqttTopicAddr::SPB: return SPB_FUNC_PREFIX;
+  }
+  return "unknown";
+}
+
+/* Parses a JSON, CBOR or MessagePack payload. Throws json::exception on malformed payloads. */
+json MqttDriver::decodeDocument(MqttTopicAddr::TopicFormat format, const std::string& payload) {
+  switch (format) {
+    case MqttTopicAddr::CBOR: return json::from_cbor(payload);
+    case MqttTopicAddr::MSGPACK: return json::from_msgpack(payload);
+    default: return json::parse(payload);
+  }
+}
+
+/*
+  Encodes the document written by output records on CBOR/MSGPACK topics: value nested under the keys
+  of the field path, as input records read it ("sensor.setpoint" gives {"sensor": {"setpoint": value}}).
+*/
+std::string MqttDriver::encodeDocument(MqttTopicAddr const& addr, json value) {
+  if (addr.documentKeys.empty())
+    throw std::logic_error(std::string(formatName(addr.format)) + " writes need a field path of keys only");
+  json doc = std::move(value);
+  for (auto key = addr.documentKeys.rbegin(); key != addr.documentKeys.rend(); ++key) {
+    json parent = json::object();
+    parent[*key] = std::move(doc);
+    doc = std::move(parent);
+  }
+  std::string out;
+  switch (addr.format) {
+    case MqttTopicAddr::CBOR: json::to_cbor(doc, out); break;
+    case MqttTopicAddr::MSGPACK: json::to_msgpack(doc, out); break;
+    default: throw std::logic_error(std::string(formatName(addr.format)) + " support not implemented");
+  }
+  return out;
+}
+
 /* Checks if a string corresponds to one of the supported topic types */
 bool MqttDriver::isSupportedTopicType(const std::string& type) {
   return MqttDriver::supportedTopicTypes.find(type) != MqttDriver::supportedTopicTypes.end();
 }
 
-bool MqttDriver::isValidTopicName(const std::string& topicName) {
+bool MqttDriver::isValidTopicName(std::string_view topicName) {
   if (topicName.empty()) return false;
   // Do not accept wildcard characters - one topic per record only
-  if (topicName.find('#') != std::string::npos || topicName.find('+') != std::string::npos) {
+  if (topicName.find_first_of("#+") != std::string_view::npos) {
     return false;
   }
   return true;
@@ -405,7 +1746,8 @@ bool MqttDriver::isSign(char character) {
   return character == '-' || character == '+';
 }
 /*
-  Checks the validity and parses the int array represented by a string into an epicsInt32 vector.
+  Checks the validity and parses the int array represented by a string into a vector of
+  epicsDataType (any signed EPICS integer type).
   Handles strings with:
 
   - Optional wrapping brackets ([ ]) - if one bracket is present, both must be;
@@ -416,14 +1758,15 @@ bool MqttDriver::isSign(char character) {
 
   - Trailing spaces (in case of comma separators);
 
-  - Signed digits.
+  - Signed digits. Values out of the range of epicsDataType are rejected.
 
   @param s: string to be parsed
-  @param out: pointer to epicsInt32 vector to be filled with data
+  @param out: vector to be filled with data
   @return asynStatus
 
 */
-asynStatus MqttDriver::checkAndParseIntArray(const std::string& s, std::vector<epicsInt32>& out) {
+template <typename epicsDataType>
+asynStatus MqttDriver::checkAndParseIntArray(const std::string& s, std::vector<epicsDataType>& out) {
   out.clear();
   if (s.empty()) return asynError;
 
@@ -435,6 +1778,7 @@ asynStatus MqttDriver::checkAndParseIntArray(const std::string& s, std::vector<e
   const char closeBracket = ']';
   bool separatorIsKnown = false;
   char separator = '\0'; // initialize to avoid compiler warnings
+  const epicsUInt64 maxPositive = static_cast<epicsUInt64>(std::numeric_limits<epicsDataType>::max());
 
   if (s[i] == openBracket) {
     if (s[end] != closeBracket) return asynError;
@@ -447,22 +1791,29 @@ asynStatus MqttDriver::checkAndParseIntArray(const std::string& s, std::vector<e
     while (i <= end && std::isspace(s[i])) i++;
     if (i > end) return asynError;
 
-    int sign = 1;
+    bool negative = false;
     if (isSign(s[i])) {
-      if (s[i] == '-') sign = -1;
+      negative = s[i] == '-';
       i++;
       if (i > end) return asynError;
     }
 
-    int val = 0;
+    // accumulate the magnitude, checking it against the type range (one more for negatives)
+    const epicsUInt64 limit = negative ? maxPositive + 1 : maxPositive;
+    epicsUInt64 val = 0;
     bool hasDigit = false;
     while (i <= end && std::isdigit(s[i])) {
-      val = val * 10 + (s[i] - '0');
+      epicsUInt64 digit = s[i] - '0';
+      if (val > (limit - digit) / 10) return asynError;
+      val = val * 10 + digit;
       i++;
       hasDigit = true;
     }
     if (!hasDigit) return asynError;
-    out.push_back(sign * val);
+    if (negative && val > 0)
+      out.push_back(static_cast<epicsDataType>(-static_cast<epicsInt64>(val - 1) - 1));
+    else
+      out.push_back(static_cast<epicsDataType>(val));
 
     if (i > end) break;
 
@@ -487,8 +1838,14 @@ asynStatus MqttDriver::checkAndParseIntArray(const std::string& s, std::vector<e
   return asynSuccess;
 }
 
+template asynStatus MqttDriver::checkAndParseIntArray<epicsInt8>(const std::string&, std::vector<epicsInt8>&);
+template asynStatus MqttDriver::checkAndParseIntArray<epicsInt16>(const std::string&, std::vector<epicsInt16>&);
+template asynStatus MqttDriver::checkAndParseIntArray<epicsInt32>(const std::string&, std::vector<epicsInt32>&);
+template asynStatus MqttDriver::checkAndParseIntArray<epicsInt64>(const std::string&, std::vector<epicsInt64>&);
+
 /*
-  Checks the validity and parses the float array represented by a string into an epicsFloat64 vector.
+  Checks the validity and parses the float array represented by a string into an epicsFloat64
+  or epicsFloat32 vector.
   Handles strings with:
 
   - Optional wrapping brackets ([ ]) - if one bracket is present, both must be;
@@ -502,11 +1859,12 @@ asynStatus MqttDriver::checkAndParseIntArray(const std::string& s, std::vector<e
   - Signed digits.
 
   @param s: string to be parsed
-  @param out: pointer to epicsFloat64 vector to be filled with data
+  @param out: vector to be filled with data
   @return asynStatus
 
 */
-asynStatus MqttDriver::checkAndParseFloatArray(const std::string& s, std::vector<epicsFloat64>& out) {
+template <typename epicsDataType>
+asynStatus MqttDriver::checkAndParseFloatArray(const std::string& s, std::vector<epicsDataType>& out) {
   out.clear();
   if (s.empty()) return asynError;
 
@@ -539,7 +1897,9 @@ asynStatus MqttDriver::checkAndParseFloatArray(const std::string& s, std::vector
     if (startPtr == endPtr) return asynError;
     size_t parsed = static_cast<size_t>(endPtr - startPtr);
     i += parsed;
-    out.push_back(val);
+    // like the integer parser, refuse values the element type cannot hold (double to float)
+    if (std::isfinite(val) && std::fabs(val) > std::numeric_limits<epicsDataType>::max()) return asynError;
+    out.push_back(static_cast<epicsDataType>(val));
 
     if (i > end) break;
 
@@ -567,24 +1927,102 @@ asynStatus MqttDriver::checkAndParseFloatArray(const std::string& s, std::vector
   return asynSuccess;
 }
 
+template asynStatus MqttDriver::checkAndParseFloatArray<epicsFloat32>(const std::string&, std::vector<epicsFloat32>&);
+template asynStatus MqttDriver::checkAndParseFloatArray<epicsFloat64>(const std::string&, std::vector<epicsFloat64>&);
+
+template <typename epicsDataType>
+asynStatus MqttDriver::checkAndParseArray(const std::string& s, std::vector<epicsDataType>& out) {
+  if constexpr (std::is_integral<epicsDataType>::value)
+    return checkAndParseIntArray(s, out);
+  else
+    return checkAndParseFloatArray(s, out);
+}
+
+/* Decodes a packed little-endian array. The payload size must be a multiple of the element size. */
+template <typename epicsDataType>
+asynStatus MqttDriver::decodeBinaryArray(const std::string& payload, std::vector<epicsDataType>& out) {
+  out.clear();
+  if (payload.size() % sizeof(epicsDataType) != 0) return asynError;
+  out.resize(payload.size() / sizeof(epicsDataType));
+  memcpy(out.data(), payload.data(), payload.size());
+#if EPICS_BYTE_ORDER == EPICS_ENDIAN_BIG
+  for (auto& value : out) {
+    char* bytes = reinterpret_cast<char*>(&value);
+    std::reverse(bytes, bytes + sizeof(epicsDataType));
+  }
+#endif
+  return asynSuccess;
+}
+
+template <typename epicsDataType>
+std::string MqttDriver::encodeBinaryArray(const epicsDataType* data, size_t count) {
+  std::string payload(reinterpret_cast<const char*>(data), count * sizeof(epicsDataType));
+#if EPICS_BYTE_ORDER == EPICS_ENDIAN_BIG
+  for (size_t i = 0; i < payload.size(); i += sizeof(epicsDataType))
+    std::reverse(payload.begin() + i, payload.begin() + i + sizeof(epicsDataType));
+#endif
+  return payload;
+}
+
+template asynStatus MqttDriver::decodeBinaryArray<epicsInt8>(const std::string&, std::vector<epicsInt8>&);
+template asynStatus MqttDriver::decodeBinaryArray<epicsInt16>(const std::string&, std::vector<epicsInt16>&);
+template asynStatus MqttDriver::decodeBinaryArray<epicsInt32>(const std::string&, std::vector<epicsInt32>&);
+template asynStatus MqttDriver::decodeBinaryArray<epicsInt64>(const std::string&, std::vector<epicsInt64>&);
+template asynStatus MqttDriver::decodeBinaryArray<epicsFloat32>(const std::string&, std::vector<epicsFloat32>&);
+template asynStatus MqttDriver::decodeBinaryArray<epicsFloat64>(const std::string&, std::vector<epicsFloat64>&);
+template std::string MqttDriver::encodeBinaryArray<epicsInt8>(const epicsInt8*, size_t);
+template std::string MqttDriver::encodeBinaryArray<epicsInt16>(const epicsInt16*, size_t);
+template std::string MqttDriver::encodeBinaryArray<epicsInt32>(const epicsInt32*, size_t);
+template std::string MqttDriver::encodeBinaryArray<epicsInt64>(const epicsInt64*, size_t);
+template std::string MqttDriver::encodeBinaryArray<epicsFloat32>(const epicsFloat32*, size_t);
+template std::string MqttDriver::encodeBinaryArray<epicsFloat64>(const epicsFloat64*, size_t);
+
+/*
+  Formats an array as a comma-separated list of values (e.g. "1,2,3"), the
+  FLAT array format accepted by checkAndParseIntArray/checkAndParseFloatArray.
+*/
+template <typename epicsDataType>
+std::string MqttDriver::formatArray(const epicsDataType* data, size_t count) {
+  std::ostringstream oss;
+  for (size_t i = 0; i < count; ++i) {
+    if (i > 0) oss << ",";
+    oss << +data[i]; // unary plus prints 8-bit integers as numbers, not characters
+  }
+  return oss.str();
+}
+
+template std::string MqttDriver::formatArray<epicsInt8>(const epicsInt8*, size_t);
+template std::string MqttDriver::formatArray<epicsInt16>(const epicsInt16*, size_t);
+template std::string MqttDriver::formatArray<epicsInt32>(const epicsInt32*, size_t);
+template std::string MqttDriver::formatArray<epicsInt64>(const epicsInt64*, size_t);
+template std::string MqttDriver::formatArray<epicsFloat32>(const epicsFloat32*, size_t);
+template std::string MqttDriver::formatArray<epicsFloat64>(const epicsFloat64*, size_t);
+
 //#############################################################################################
 // IO function definitions
 
-WriteResult MqttDriver::integerWrite(DeviceVariable& deviceVar, epicsInt32 value) {
+template <typename epicsDataType>
+WriteResult MqttDriver::integerWrite(DeviceVariable& deviceVar, epicsDataType value) {
   WriteResult result;
   asynStatus status = asynError;
   const char* functionName = __FUNCTION__;
   MqttTopicAddr const& addr = static_cast<MqttTopicAddr const&>(deviceVar.address());
-  std::string topicName = addr.topicName;
+  const std::string& topicName = addr.topic.name();
   MqttDriver* driver = static_cast<MqttTopicVariable&>(deviceVar).driver;
   try {
     if (addr.format == MqttTopicAddr::TopicFormat::FLAT) {
-      driver->mqttClient.publish(addr.topicName, std::to_string(value));
+      driver->mqttClient->publish(addr.topic.name(), std::to_string(value));
       status = asynSuccess;
     }
     else if (addr.format == MqttTopicAddr::TopicFormat::JSON) {
-      // TODO: implement JSON support for integer values
-      throw std::logic_error("JSON support not implemented");
+      std::string& payload = static_cast<MqttTopicVariable&>(deviceVar).writeBuffer;
+      addr.jsonTemplate.render(value, payload);
+      driver->mqttClient->publish(addr.topic.name(), payload);
+      status = asynSuccess;
+    }
+    else {
+      driver->mqttClient->publish(addr.topic.name(), encodeDocument(addr, value));
+      status = asynSuccess;
     }
   }
   catch (const std::exception& exc) {
@@ -602,32 +2040,34 @@ WriteResult MqttDriver::digitalWrite(DeviceVariable& deviceVar, epicsUInt32 cons
   asynStatus status = asynError;
   const char* functionName = __FUNCTION__;
   MqttTopicAddr const& addr = static_cast<MqttTopicAddr const&>(deviceVar.address());
-  std::string topicName = addr.topicName;
+  const std::string& topicName = addr.topic.name();
   MqttDriver* driver = static_cast<MqttTopicVariable&>(deviceVar).driver;
   epicsUInt32 outVal = value;
   try {
-    if (addr.format == MqttTopicAddr::TopicFormat::FLAT) {
-      if (mask != 0xFFFFFFFF) {
-        // read current value to avoid overwriting other bits when applying mask
-        epicsUInt32 auxVal;
-        status = driver->getUIntDigitalParam(deviceVar.asynIndex(), &auxVal, 0xFFFFFFFF);
-        if (status == asynParamUndefined) {
-          throw std::logic_error("Masked write attempted on uninitialized value (current topic value is unknown)");
-        }
-        else if (status != asynSuccess) {
-          throw std::logic_error("Error reading current param value");
-        }
-        auxVal |= (value & mask);
-        auxVal &= (value | ~mask);
-        outVal = auxVal;
+    if (mask != 0xFFFFFFFF) {
+      // read current value to avoid overwriting other bits when applying mask
+      epicsUInt32 auxVal;
+      status = driver->getUIntDigitalParam(deviceVar.asynIndex(), &auxVal, 0xFFFFFFFF);
+      if (status == asynParamUndefined) {
+        throw std::logic_error("Masked write attempted on uninitialized value (current topic value is unknown)");
       }
-      driver->mqttClient.publish(addr.topicName, std::to_string(outVal));
-      status = asynSuccess;
+      else if (status != asynSuccess) {
+        throw std::logic_error("Error reading current param value");
+      }
+      auxVal |= (value & mask);
+      auxVal &= (value | ~mask);
+      outVal = auxVal;
     }
+    if (addr.format == MqttTopicAddr::TopicFormat::FLAT)
+      driver->mqttClient->publish(addr.topic.name(), std::to_string(outVal));
     else if (addr.format == MqttTopicAddr::TopicFormat::JSON) {
-      // TODO: implement JSON support for digital values
-      throw std::logic_error("JSON support not implemented");
+      std::string& payload = static_cast<MqttTopicVariable&>(deviceVar).writeBuffer;
+      addr.jsonTemplate.render(outVal, payload);
+      driver->mqttClient->publish(addr.topic.name(), payload);
     }
+    else
+      driver->mqttClient->publish(addr.topic.name(), encodeDocument(addr, outVal));
+    status = asynSuccess;
   }
   catch (const std::exception& exc) {
     status = asynError;
@@ -644,16 +2084,22 @@ WriteResult MqttDriver::floatWrite(DeviceVariable& deviceVar, epicsFloat64 value
   asynStatus status = asynError;
   const char* functionName = __FUNCTION__;
   MqttTopicAddr const& addr = static_cast<MqttTopicAddr const&>(deviceVar.address());
-  std::string topicName = addr.topicName;
+  const std::string& topicName = addr.topic.name();
   MqttDriver* driver = static_cast<MqttTopicVariable&>(deviceVar).driver;
   try {
     if (addr.format == MqttTopicAddr::TopicFormat::FLAT) {
-      driver->mqttClient.publish(addr.topicName, std::to_string(value));
+      driver->mqttClient->publish(addr.topic.name(), std::to_string(value));
       status = asynSuccess;
     }
     else if (addr.format == MqttTopicAddr::TopicFormat::JSON) {
-      // TODO: implement JSON support for float values
-      throw std::logic_error("JSON support not implemented");
+      std::string& payload = static_cast<MqttTopicVariable&>(deviceVar).writeBuffer;
+      addr.jsonTemplate.render(value, payload);
+      driver->mqttClient->publish(addr.topic.name(), payload);
+      status = asynSuccess;
+    }
+    else {
+      driver->mqttClient->publish(addr.topic.name(), encodeDocument(addr, value));
+      status = asynSuccess;
     }
   }
   catch (const std::exception& exc) {
@@ -672,25 +2118,31 @@ WriteResult MqttDriver::arrayWrite(DeviceVariable& deviceVar, Array<epicsDataTyp
   asynStatus status = asynError;
   const char* functionName = __FUNCTION__;
   MqttTopicAddr const& addr = static_cast<MqttTopicAddr const&>(deviceVar.address());
-  std::string topicName = addr.topicName;
+  const std::string& topicName = addr.topic.name();
   MqttDriver* driver = static_cast<MqttTopicVariable&>(deviceVar).driver;
   try {
+    // JSON arrays are rendered in place; the other formats build their payload and keep it
+    std::string& payload = static_cast<MqttTopicVariable&>(deviceVar).writeBuffer;
     if (addr.format == MqttTopicAddr::TopicFormat::FLAT) {
       const epicsDataType* arrayData = reinterpret_cast<const epicsDataType*>(value.data());
-      size_t count = value.size();
-
-      std::ostringstream oss;
-      for (size_t i = 0; i < count; ++i) {
-        if (i > 0) oss << ",";
-        oss << arrayData[i];
-      }
-      driver->mqttClient.publish(topicName, oss.str());
-      status = asynSuccess;
+      payload = formatArray(arrayData, value.size());
+    }
+    else if (addr.format == MqttTopicAddr::TopicFormat::BIN) {
+      payload = encodeBinaryArray(value.data(), value.size());
     }
     else if (addr.format == MqttTopicAddr::TopicFormat::JSON) {
-      // TODO: implement JSON support for array values
-      throw std::logic_error("JSON support not implemented");
+      addr.jsonTemplate.renderArray(value.data(), value.size(), payload);
+    }
+    else {
+      payload = encodeDocument(addr, std::vector<epicsDataType>(value.data(), value.data() + value.size()));
     }
+    if (addr.codec != MQTT_CODEC_NONE) {
+      std::string compressed;
+      mqttCompress(addr.codec, payload, compressed);
+      payload.swap(compressed);
+    }
+    driver->mqttClient->publish(topicName, payload);
+    status = asynSuccess;
   }
   catch (const std::exception& exc) {
     status = asynError;
@@ -707,19 +2159,28 @@ WriteResult MqttDriver::stringWrite(DeviceVariable& deviceVar, Octet const& valu
   asynStatus status = asynError;
   const char* functionName = __FUNCTION__;
   MqttTopicAddr const& addr = static_cast<MqttTopicAddr const&>(deviceVar.address());
-  std::string topicName = addr.topicName;
+  const std::string& topicName = addr.topic.name();
   MqttDriver* driver = static_cast<MqttTopicVariable&>(deviceVar).driver;
   try {
     if (addr.format == MqttTopicAddr::TopicFormat::FLAT) {
       std::vector<char> stringData(value.maxSize());
       if (value.writeTo(stringData.data(), stringData.size())) {
-        driver->mqttClient.publish(addr.topicName, stringData.data());
+        driver->mqttClient->publish(addr.topic.name(), stringData.data());
         status = asynSuccess;
       }
     }
     else if (addr.format == MqttTopicAddr::TopicFormat::JSON) {
-      // TODO: implement JSON support for string values
-      throw std::logic_error("JSON support not implemented");
+      std::string& payload = static_cast<MqttTopicVariable&>(deviceVar).writeBuffer;
+      addr.jsonTemplate.renderString(std::string_view(value.data(), strnlen(value.data(), value.size())), payload);
+      driver->mqttClient->publish(addr.topic.name(), payload);
+      status = asynSuccess;
+    }
+    else {
+      std::vector<char> stringData(value.maxSize());
+      if (value.writeTo(stringData.data(), stringData.size())) {
+        driver->mqttClient->publish(addr.topic.name(), encodeDocument(addr, std::string(stringData.data())));
+        status = asynSuccess;
+      }
     }
   }
   catch (const std::exception& exc) {
@@ -734,39 +2195,307 @@ WriteResult MqttDriver::stringWrite(DeviceVariable& deviceVar, Octet const& valu
 //#############################################################################################
 //EPICS shell script function definition
 extern "C" {
-  int mqttDriverConfigure(const char* portName, const char* brokerUrl, const char* mqttClientID, const int qos) {
-    new MqttDriver(portName, brokerUrl, mqttClientID, qos);
+  int mqttDriverConfigure(const char* portName, const char* brokerUrl, const char* mqttClientID, const int qos,
+    const char* options) {
+    try {
+      new MqttDriver(portName, brokerUrl, mqttClientID, qos, MqttDriver::Options::parse(options));
+    }
+    catch (const std::exception& e) {
+      fprintf(stderr, "mqttDriverConfigure: %s\n", e.what());
+      return(asynError);
+    }
     return(asynSuccess);
   }
-  static const int numArgs = 4;
+  static const int numArgs = 5;
   static const iocshArg initArg0 = { "portName", iocshArgString };
   static const iocshArg initArg1 = { "brokerUrl", iocshArgString };
   static const iocshArg initArg2 = { "mqttClientID", iocshArgString };
   static const iocshArg initArg3 = { "qos", iocshArgInt };
+  static const iocshArg initArg4 = { "options", iocshArgString };
   static const iocshArg* const initArgs[] = {
       &initArg0,
       &initArg1,
       &initArg2,
-      &initArg3
+      &initArg3,
+      &initArg4
   };
   static const char* usage =
-    "MqttDriverConfigure(portName, brokerUrl, mqttClientID, qos)\n"
+    "MqttDriverConfigure(portName, brokerUrl, mqttClientID, qos, [options])\n"
     "  portName: Asyn port name to be used\n"
     "  brokerUrl: Broker IP or hostname (e.g: mqtt://localhost:1883)\n"
     "  mqttClientID: ClientID to be used - must be unique\n"
-    "  qos: Desired quality of service (QoS) for the connection [0|1|2]\n";
+    "  qos: Desired quality of service (QoS) for the connection [0|1|2]\n"
+    "  options: Optional comma-separated key=value settings:\n"
+    "    warmStartTimeout=<s>: wait up to <s> seconds at iocInit for retained messages\n"
+    "    snapshotFile=<path>: save/restore last values to/from <path>\n"
+    "    snapshotPeriod=<s>: seconds between snapshot writes (default 10)\n"
+    "    snapshotSeverity=<sevr>: alarm of restored values, NO_ALARM|MINOR|MAJOR|INVALID (default MINOR)\n"
+    "    cleanStart=<0|1>: 0 resumes the previous MQTT session of this client ID (default 1)\n"
+    "    sessionExpiry=<s>: seconds the broker keeps a persistent session (default 300, above 0 with cleanStart=0)\n"
+    "    persistDir=<path>: directory for durable storage of in-flight messages\n"
+    "    reconnectMinDelay=<s>: first reconnect delay, doubled after each failure (default 1)\n"
+    "    reconnectMaxDelay=<s>: maximum reconnect delay (default 60)\n"
+    "    reconnectJitter=<f>: random fraction (0 to 1) removed from each delay (default 0.5)\n"
+    "    lazySubscribe=<0|1>: subscribe only to topics with registered I/O Intr interrupts (default 0)\n"
+    "    lazyIdleTimeout=<s>: seconds before an unused lazy topic is unsubscribed (default 60)\n";
 
   //#############################################################################################
   static const iocshFuncDef initFuncDef = { "mqttDriverConfigure", numArgs, initArgs, usage };
 
   //#############################################################################################
   static void initCallFunc(const iocshArgBuf* args) {
-    mqttDriverConfigure(args[0].sval, args[1].sval, args[2].sval, args[3].ival);
+    mqttDriverConfigure(args[0].sval, args[1].sval, args[2].sval, args[3].ival, args[4].sval);
+  }
+
+  //#############################################################################################
+  static const iocshArg traceDumpArg0 = { "portName", iocshArgString };
+  static const iocshArg traceDumpArg1 = { "count", iocshArgInt };
+  static const iocshArg* const traceDumpArgs[] = {
+      &traceDumpArg0,
+      &traceDumpArg1
+  };
+  static const char* traceDumpUsage =
+    "mqttTraceDump(portName, count)\n"
+    "  portName: Asyn port name of the MQTT driver\n"
+    "  count: Number of most recent trace events to print (default 20)\n";
+  static const iocshFuncDef traceDumpFuncDef = { "mqttTraceDump", 2, traceDumpArgs, traceDumpUsage };
+
+  static void traceDumpCallFunc(const iocshArgBuf* args) {
+    MqttDriver* driver = MqttDriver::findDriver(args[0].sval);
+    if (!driver) {
+      fprintf(stderr, "mqttTraceDump: MQTT port '%s' not found\n", args[0].sval ? args[0].sval : "");
+      return;
+    }
+    driver->traceDump(stdout, args[1].ival > 0 ? args[1].ival : 20);
+  }
+
+  //#############################################################################################
+  static const iocshArg captureStartArg0 = { "portName", iocshArgString };
+  static const iocshArg captureStartArg1 = { "fileName", iocshArgString };
+  static const iocshArg* const captureStartArgs[] = {
+      &captureStartArg0,
+      &captureStartArg1
+  };
+  static const char* captureStartUsage =
+    "mqttCaptureStart(portName, fileName)\n"
+    "  portName: Asyn port name of the MQTT driver\n"
+    "  fileName: Capture log to write (truncated if it exists)\n";
+  static const iocshFuncDef captureStartFuncDef = { "mqttCaptureStart", 2, captureStartArgs, captureStartUsage };
+
+  static void captureStartCallFunc(const iocshArgBuf* args) {
+    MqttDriver* driver = MqttDriver::findDriver(args[0].sval);
+    if (!driver || !args[1].sval) {
+      fprintf(stderr, "%s\n", captureStartUsage);
+      return;
+    }
+    try {
+      driver->transport().startCapture(args[1].sval);
+    }
+    catch (const std::exception& e) {
+      fprintf(stderr, "mqttCaptureStart: %s\n", e.what());
+    }
+  }
+
+  static const iocshArg captureStopArg0 = { "portName", iocshArgString };
+  static const iocshArg* const captureStopArgs[] = { &captureStopArg0 };
+  static const char* captureStopUsage =
+    "mqttCaptureStop(portName)\n"
+    "  portName: Asyn port name of the MQTT driver\n";
+  static const iocshFuncDef captureStopFuncDef = { "mqttCaptureStop", 1, captureStopArgs, captureStopUsage };
+
+  static void captureStopCallFunc(const iocshArgBuf* args) {
+    MqttDriver* driver = MqttDriver::findDriver(args[0].sval);
+    if (!driver) {
+      fprintf(stderr, "%s\n", captureStopUsage);
+      return;
+    }
+    printf("mqttCaptureStop: %llu messages captured\n", (unsigned long long)driver->transport().stopCapture());
+  }
+
+  static const iocshArg replayArg0 = { "portName", iocshArgString };
+  static const iocshArg replayArg1 = { "fileName", iocshArgString };
+  static const iocshArg replayArg2 = { "speed", iocshArgDouble };
+  static const iocshArg* const replayArgs[] = {
+      &replayArg0,
+      &replayArg1,
+      &replayArg2
+  };
+  static const char* replayUsage =
+    "mqttReplay(portName, fileName, speed)\n"
+    "  portName: Asyn port name of the MQTT driver\n"
+    "  fileName: Capture log written by mqttCaptureStart\n"
+    "  speed: 1 = original timing, N = N times faster, 0 = as fast as possible\n";
+  static const iocshFuncDef replayFuncDef = { "mqttReplay", 3, replayArgs, replayUsage };
+
+  static void replayCallFunc(const iocshArgBuf* args) {
+    MqttDriver* driver = MqttDriver::findDriver(args[0].sval);
+    if (!driver || !args[1].sval) {
+      fprintf(stderr, "%s\n", replayUsage);
+      return;
+    }
+    try {
+      driver->replayCapture(args[1].sval, args[2].dval);
+    }
+    catch (const std::exception& e) {
+      fprintf(stderr, "mqttReplay: %s\n", e.what());
+    }
+  }
+
+  //#############################################################################################
+  static const iocshArg bindArg0 = { "portName", iocshArgString };
+  static const iocshArg bindArg1 = { "brokerTopic", iocshArgString };
+  static const iocshArg bindArg2 = { "recordTopic", iocshArgString };
+  static const iocshArg* const bindArgs[] = {
+      &bindArg0,
+      &bindArg1,
+      &bindArg2
+  };
+  static const char* bindUsage =
+    "mqttBind(portName, brokerTopic, recordTopic)\n"
+    "  portName: Asyn port name of the MQTT driver\n"
+    "  brokerTopic: Topic to subscribe to on the broker\n"
+    "  recordTopic: Topic used in the record links that receive its messages\n";
+  static const iocshFuncDef bindFuncDef = { "mqttBind", 3, bindArgs, bindUsage };
+
+  static void bindCallFunc(const iocshArgBuf* args) {
+    MqttDriver* driver = MqttDriver::findDriver(args[0].sval);
+    if (!driver || !args[1].sval || !args[2].sval) {
+      fprintf(stderr, "%s\n", bindUsage);
+      return;
+    }
+    try {
+      driver->bindTopic(args[1].sval, args[2].sval);
+    }
+    catch (const std::exception& e) {
+      fprintf(stderr, "mqttBind: %s\n", e.what());
+    }
+  }
+
+  static const iocshArg unbindArg0 = { "portName", iocshArgString };
+  static const iocshArg unbindArg1 = { "brokerTopic", iocshArgString };
+  static const iocshArg* const unbindArgs[] = {
+      &unbindArg0,
+      &unbindArg1
+  };
+  static const char* unbindUsage =
+    "mqttUnbind(portName, brokerTopic)\n"
+    "  portName: Asyn port name of the MQTT driver\n"
+    "  brokerTopic: Bound broker topic to remove\n";
+  static const iocshFuncDef unbindFuncDef = { "mqttUnbind", 2, unbindArgs, unbindUsage };
+
+  static void unbindCallFunc(const iocshArgBuf* args) {
+    MqttDriver* driver = MqttDriver::findDriver(args[0].sval);
+    if (!driver || !args[1].sval) {
+      fprintf(stderr, "%s\n", unbindUsage);
+      return;
+    }
+    if (!driver->unbindTopic(args[1].sval))
+      fprintf(stderr, "mqttUnbind: topic '%s' is not bound\n", args[1].sval);
+  }
+
+  static const iocshArg loadBindingsArg0 = { "portName", iocshArgString };
+  static const iocshArg loadBindingsArg1 = { "fileName", iocshArgString };
+  static const iocshArg* const loadBindingsArgs[] = {
+      &loadBindingsArg0,
+      &loadBindingsArg1
+  };
+  static const char* loadBindingsUsage =
+    "mqttLoadBindings(portName, fileName)\n"
+    "  portName: Asyn port name of the MQTT driver\n"
+    "  fileName: Bindings file, one 'brokerTopic recordTopic' pair per line.\n"
+    "            Replaces the current bindings; only the changes are applied.\n";
+  static const iocshFuncDef loadBindingsFuncDef = { "mqttLoadBindings", 2, loadBindingsArgs, loadBindingsUsage };
+
+  static void loadBindingsCallFunc(const iocshArgBuf* args) {
+    MqttDriver* driver = MqttDriver::findDriver(args[0].sval);
+    if (!driver || !args[1].sval) {
+      fprintf(stderr, "%s\n", loadBindingsUsage);
+      return;
+    }
+    try {
+      size_t added, removed;
+      driver->loadBindings(args[1].sval, added, removed);
+      printf("mqttLoadBindings: %zu topics subscribed, %zu unsubscribed\n", added, removed);
+    }
+    catch (const std::exception& e) {
+      fprintf(stderr, "mqttLoadBindings: %s\n", e.what());
+    }
+  }
+
+  static const iocshArg bindingsShowArg0 = { "portName", iocshArgString };
+  static const iocshArg* const bindingsShowArgs[] = { &bindingsShowArg0 };
+  static const char* bindingsShowUsage =
+    "mqttBindingsShow(portName)\n"
+    "  portName: Asyn port name of the MQTT driver\n";
+  static const iocshFuncDef bindingsShowFuncDef = { "mqttBindingsShow", 1, bindingsShowArgs, bindingsShowUsage };
+
+  static void bindingsShowCallFunc(const iocshArgBuf* args) {
+    MqttDriver* driver = MqttDriver::findDriver(args[0].sval);
+    if (!driver) {
+      fprintf(stderr, "%s\n", bindingsShowUsage);
+      return;
+    }
+    driver->bindingsReport(stdout);
+  }
+
+  static const iocshArg startupReportArg0 = { "portName", iocshArgString };
+  static const iocshArg* const startupReportArgs[] = { &startupReportArg0 };
+  static const char* startupReportUsage =
+    "mqttStartupReport(portName)\n"
+    "  portName: Asyn port name of the MQTT driver\n";
+  static const iocshFuncDef startupReportFuncDef = { "mqttStartupReport", 1, startupReportArgs, startupReportUsage };
+
+  static void startupReportCallFunc(const iocshArgBuf* args) {
+    MqttDriver* driver = MqttDriver::findDriver(args[0].sval);
+    if (!driver) {
+      fprintf(stderr, "%s\n", startupReportUsage);
+      return;
+    }
+    driver->startupReport(stdout);
+  }
+
+  static const iocshArg imageArg0 = { "portName", iocshArgString };
+  static const iocshArg imageArg1 = { "pvName", iocshArgString };
+  static const iocshArg imageArg2 = { "topic", iocshArgString };
+  static const iocshArg* const imageArgs[] = {
+      &imageArg0,
+      &imageArg1,
+      &imageArg2
+  };
+  static const char* imageUsage =
+    "mqttImageConfigure(portName, pvName, topic)\n"
+    "  portName: Asyn port name of the MQTT driver\n"
+    "  pvName: Name of the NTNDArray PV served over PVA\n"
+    "  topic: Topic carrying the image frames. Must be called before iocInit.\n";
+  static const iocshFuncDef imageFuncDef = { "mqttImageConfigure", 3, imageArgs, imageUsage };
+
+  static void imageCallFunc(const iocshArgBuf* args) {
+    MqttDriver* driver = MqttDriver::findDriver(args[0].sval);
+    if (!driver || !args[1].sval || !args[2].sval) {
+      fprintf(stderr, "%s\n", imageUsage);
+      return;
+    }
+    try {
+      driver->addImage(args[1].sval, args[2].sval);
+    }
+    catch (const std::exception& e) {
+      fprintf(stderr, "mqttImageConfigure: %s\n", e.what());
+    }
   }
 
   //#############################################################################################
   void mqttDriverRegister(void) {
     iocshRegister(&initFuncDef, initCallFunc);
+    iocshRegister(&traceDumpFuncDef, traceDumpCallFunc);
+    iocshRegister(&captureStartFuncDef, captureStartCallFunc);
+    iocshRegister(&captureStopFuncDef, captureStopCallFunc);
+    iocshRegister(&replayFuncDef, replayCallFunc);
+    iocshRegister(&bindFuncDef, bindCallFunc);
+    iocshRegister(&unbindFuncDef, unbindCallFunc);
+    iocshRegister(&loadBindingsFuncDef, loadBindingsCallFunc);
+    iocshRegister(&bindingsShowFuncDef, bindingsShowCallFunc);
+    iocshRegister(&startupReportFuncDef, startupReportCallFunc);
+    iocshRegister(&imageFuncDef, imageCallFunc);
   }
 
   epicsExportRegistrar(mqttDriverRegister);
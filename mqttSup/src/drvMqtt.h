@@ -11,19 +11,88 @@
 #include <autoparamHandler.h>
 #include <asynPortDriver.h>
 #include <sstream>
-#include "mqttClient.h"
+#include <epicsThread.h>
+#include <epicsEvent.h>
+#include <alarm.h>
+#include "mqttTransport.h"
+#include "mqttTrace.h"
+#include "mqttCodec.h"
 #include "json/json.hpp"
+#include "mqttJsonExtractor.h"
+#include "mqttJsonTemplate.h"
+#include "mqttTopic.h"
+#include <functional>
 #include <unordered_set>
+#include <unordered_map>
 
 using namespace Autoparam::Convenience;
 using json = nlohmann::json;
 
 static const char* driverName = "MqttDriver";
 
+class MqttTopicVariable;
+class MqttImageServer;
+struct MqttSparkplugTopic;
+struct MqttSparkplugMetric;
+
+class MqttTopicAddr : public DeviceAddress {
+public:
+  enum TopicFormat { FLAT, JSON, BIN, CBOR, MSGPACK, SPB };
+
+  TopicFormat format;
+  MqttCodec codec = MQTT_CODEC_NONE;
+  MqttTopic topic;        // SPB: subscription filter of the edge node, "spBv1.0/<group>/+/<edge node>/#"
+  MqttTopic sparkplugDevice; // SPB: routing key of the node/device, "spBv1.0/<group>/+/<edge node>[/<device>]"
+  std::string jsonField;  // SPB: metric name
+  MqttJsonTemplate jsonTemplate; // JSON: payload written by output records, compiled from jsonField
+  std::vector<std::string> documentKeys; // CBOR, MSGPACK: nested keys written by output records, empty if jsonField has indices
+  epicsUInt32 mask = 0xFFFFFFFF;
+  bool operator==(DeviceAddress const& comparedAddr) const;
+  /* true for formats addressing a field of a document (JSON, CBOR, MSGPACK) */
+  bool isDocument() const { return format == JSON || format == CBOR || format == MSGPACK; }
+  /* allocated from a pool of blocks, one address per record link */
+  static void* operator new(size_t size);
+  static void operator delete(void* ptr, size_t size);
+};
+
 class MqttDriver : public Autoparam::Driver {
 public:
+  /*! \brief Optional driver settings.
+   *
+   * Given to mqttDriverConfigure as a list of "key=value" pairs separated by
+   * commas (e.g. "warmStartTimeout=5"). Unset keys keep their defaults.
+   */
+  struct Options {
+    /* Seconds iocInit waits for retained messages on the subscribed topics. 0 disables warm start. */
+    double warmStartTimeout = 0;
+    /* Last-value snapshot file; empty disables snapshots */
+    std::string snapshotFile;
+    /* Seconds between snapshot writes (only written if values changed) */
+    double snapshotPeriod = 10;
+    /* Alarm severity of values restored from the snapshot, until a fresh message arrives */
+    int snapshotSeverity = epicsSevMinor;
+    /* Start a clean MQTT session; false resumes the previous session of this client ID */
+    bool cleanStart = true;
+    /* Seconds the broker keeps the session after a disconnect (persistent sessions only) */
+    int sessionExpiry = 300;
+    /* Directory for Paho file persistence of in-flight QoS 1/2 messages; empty keeps them in memory */
+    std::string persistDir;
+    /* Reconnect backoff in seconds and jitter fraction, see MqttTransport::Config */
+    double reconnectMinDelay = 1;
+    double reconnectMaxDelay = 60;
+    double reconnectJitter = 0.5;
+    /* Subscribe to a topic only while some record on it has an I/O Intr interrupt registered */
+    bool lazySubscribe = false;
+    /* Seconds a lazy topic stays subscribed after its last interrupt is cancelled */
+    double lazyIdleTimeout = 60;
+
+    /* Throws std::invalid_argument on unknown keys or malformed values */
+    static Options parse(const char* str);
+  };
+
   /* Constructor */
-  MqttDriver(const char* portName, const char* mqttBrokerAddr, const char* mqttClientID, const int qos);
+  MqttDriver(const char* portName, const char* mqttBrokerAddr, const char* mqttClientID, const int qos,
+    const Options& options);
   /* Destructor */
   ~MqttDriver();
   /*! \brief Supported types for MQTT topics.
@@ -33,11 +102,45 @@ public:
    * types (e.g. "FLAT:INT", "JSON:FLOAT", etc.)
    */
   static const std::unordered_set<std::string> supportedTopicTypes;
+  /* Returns the MqttDriver registered under an asyn port name, or nullptr */
+  static MqttDriver* findDriver(const char* portName);
+  /* Prints the hot-path counters and the last 'count' trace events */
+  void traceDump(FILE* fp, size_t count) const;
+  /* Transport used to talk to the broker (e.g. to inject messages in benchmarks) */
+  MqttTransport& transport() { return *mqttClient; }
+  /* Feeds a capture log (see mqttCapture.h) to the message callback from a
+     background thread. speed: 1 = original timing, N = N times faster,
+     0 = as fast as possible. Throws if the file cannot be opened or the thread
+     cannot be created. */
+  void replayCapture(const std::string& path, double speed);
+  /* Runtime topic bindings: messages on brokerTopic are routed to the records
+     whose topic is recordTopic, instead of the records of brokerTopic itself.
+     Only the broker topics that changed are subscribed/unsubscribed.
+     Throw std::invalid_argument on invalid topic names. */
+  void bindTopic(const std::string& brokerTopic, const std::string& recordTopic);
+  /* Returns false if brokerTopic was not bound */
+  bool unbindTopic(const std::string& brokerTopic);
+  /* Replaces all bindings with the ones in a bindings file ("brokerTopic
+     recordTopic" per line, '#' starts a comment), applying only the delta.
+     Throws on unreadable files or malformed lines, leaving bindings untouched. */
+  void loadBindings(const std::string& path, size_t& added, size_t& removed);
+  void bindingsReport(FILE* fp);
+  /* Prints the time spent parsing record addresses, binding variables and setting up subscriptions */
+  void startupReport(FILE* fp);
+  /* Serves frames published on topic as the NTNDArray PV pvName (see
+     mqttImage.h). Must be called before iocInit; throws std::invalid_argument
+     on invalid topic names or duplicate topics/PVs, std::logic_error after iocInit. */
+  void addImage(const std::string& pvName, const std::string& topic);
 
 protected:
+  /* Registers the handlers of every supported type for a payload format prefix; read-only formats
+     get no write handlers, so writes to their output records fail */
+  void registerFormat(const std::string& prefix, bool withScalars, bool withCodecs = true, bool withWrites = true);
+
   static void initHook(Autoparam::Driver* driver);
   // read/write for scalars
-  static WriteResult integerWrite(DeviceVariable& deviceVar, epicsInt32 value);
+  template <typename epicsDataType>
+  static WriteResult integerWrite(DeviceVariable& deviceVar, epicsDataType value);
   static WriteResult digitalWrite(DeviceVariable& deviceVar, epicsUInt32 const value, epicsUInt32 const mask = 0xffffffff);
   static WriteResult floatWrite(DeviceVariable& deviceVar, epicsFloat64 value);
   // read/write for arrays
@@ -52,33 +155,158 @@ protected:
   static void onSubscribeCb(Autoparam::Driver* driver, const std::string& topic);
   static void onPublishCb(Autoparam::Driver* driver, const std::string& topic);
   static void onFailCb(Autoparam::Driver* driver, const std::string& errMsg);
+  static void replayTask(void* arg);
+  static asynStatus interruptRegistrar(DeviceVariable& deviceVar, bool cancel);
 
 private:
-  MqttClient mqttClient;
+  std::unique_ptr<MqttTransport> mqttClient;
+  Options options;
+  /* warm start state, guarded by the driver lock */
+  bool warmingUp = false;
+  size_t warmTopicCount = 0;
+  std::unordered_set<std::string> warmPendingTopics;
+  epicsEventId warmDoneEvent;
+  void warmStart();
+  /* last-value snapshot state, guarded by the driver lock */
+  bool snapshotDirty = false;
+  epicsEventId snapshotStopEvent;
+  epicsEventId snapshotDoneEvent; // signaled by snapshotTask when it returns
+  bool snapshotRunning = false;   // snapshotTask started and not joined yet
+  void stopSnapshotTask();
+  void loadSnapshot();
+  void writeSnapshot();
+  void keepSnapshot(MqttTopicVariable& deviceVar, const void* data, size_t size);
+  static std::string snapshotKey(const MqttTopicVariable& deviceVar);
+  template <typename epicsDataType>
+  void restoreArray(MqttTopicVariable& deviceVar, const std::string& value, int alarmStatus, int alarmSeverity);
+  static void snapshotTask(void* arg);
+  static void snapshotAtExit(void* arg);
+  /* lazy subscription state, guarded by the driver lock */
+  struct LazyTopic {
+    int demand = 0;           // registered interrupts on the topic
+    bool subscribed = false;
+    epicsUInt64 idleSinceNs = 0;
+  };
+  bool connected = false;
+  std::unordered_map<std::string, LazyTopic> lazyTopics;
+  epicsEventId lazyStopEvent;
+  epicsEventId lazyDoneEvent; // signaled by lazyTask when it returns
+  bool lazyRunning = false;   // lazyTask started and not joined yet
+  void stopLazyTask();
+  static void lazyTask(void* arg);
+  /* runtime topic bindings (broker topic -> record topic), guarded by the driver lock */
+  std::unordered_map<std::string, std::string> topicBindings;
+  typedef std::unordered_map<std::string, std::string> TopicBindings;
+  bool applyBindings(const std::function<bool(TopicBindings&)>& edit, size_t* added, size_t* removed);
+  /* image topics served over PVA, created by the first addImage() */
+  std::unique_ptr<MqttImageServer> imageServer;
+  bool started = false; // set at iocInit
+  /* Sparkplug B routing tables, built at record initialization; contents guarded by the driver lock */
+  struct SparkplugMetric {
+    epicsUInt32 datatype = 0; // learned from BIRTH, DATA messages usually omit it
+    std::vector<MqttTopicVariable*> vars;
+  };
+  struct SparkplugDevice {
+    std::unordered_map<std::string, SparkplugMetric> byName;
+    std::unordered_map<epicsUInt64, SparkplugMetric*> byAlias; // learned from BIRTH
+  };
+  std::unordered_map<std::string, SparkplugDevice> sparkplugDevices; // by routing key, see MqttTopicAddr
+  std::unordered_map<std::string, epicsUInt64> sparkplugBirthSeq; // bdSeq of the last NBIRTH, by node key
+  std::string sparkplugKey, sparkplugFilter, sparkplugName, sparkplugValue; // reused lookup/conversion buffers
+  std::vector<epicsInt64> sparkplugArray;
+  void dispatchSparkplug(const MqttSparkplugTopic& topic, const std::string& payload);
+  void updateSparkplugVar(MqttTopicVariable& deviceVar, const MqttSparkplugMetric& metric);
+  template <typename epicsDataType>
+  void updateSparkplugArray(MqttTopicVariable& deviceVar, const MqttSparkplugMetric& metric);
+  void markSparkplugDead(SparkplugDevice& device);
+  /* decompressed payload of the current message, reused across messages; guarded by the driver lock */
+  std::string decodeBuffer;
+  /* field extractors of the document records, one per format, codec and topic; built at record
+     initialization, guarded by the driver lock */
+  std::unordered_map<std::string, MqttJsonExtractor> documentExtractors;
+  /* value of a message for one record: the payload or field text, or the numbers read from a document */
+  struct FieldValue {
+    const std::string* text = nullptr;
+    const MqttJsonNumber* number = nullptr;
+    const void* elements = nullptr; // count elements converted into the array type of the record
+    size_t count = 0;
+  };
+  typedef void (MqttDriver::*Updater)(MqttTopicVariable& deviceVar, const FieldValue& field);
+  /* binding of a record to its topic: where its value is in the message and how it is converted */
+  struct TopicRecord {
+    MqttTopicVariable* var = nullptr;
+    MqttJsonExtractor* extractor = nullptr; // document formats
+    size_t slot = 0;                        // path of the record in extractor
+    MqttCodec codec = MQTT_CODEC_NONE;
+    bool numeric = false;                   // scalar number record, reads document numbers without text
+    Updater update = nullptr;
+    int interrupts = 0;                     // registered I/O Intr interrupts; records without any get no messages
+  };
+  /* records of each record topic (SPB excepted), keyed by the interned topic name; built at record
+     initialization, guarded by the driver lock */
+  std::unordered_map<std::string_view, std::vector<TopicRecord>> topicRecords;
+  static Updater updaterFor(asynParamType type);
+  static MqttJsonExtractor::ElementType elementTypeFor(asynParamType type);
+  void updateInt32(MqttTopicVariable& deviceVar, const FieldValue& field);
+  void updateInt64(MqttTopicVariable& deviceVar, const FieldValue& field);
+  void updateFloat64(MqttTopicVariable& deviceVar, const FieldValue& field);
+  void updateDigital(MqttTopicVariable& deviceVar, const FieldValue& field);
+  void updateString(MqttTopicVariable& deviceVar, const FieldValue& field);
+  template <typename epicsDataType>
+  void updateArray(MqttTopicVariable& deviceVar, const FieldValue& field);
+  /* startup timing, see startupReport; the address and variable fields are written at record
+     initialization, the connection fields are guarded by the driver lock */
+  struct StartupStats {
+    size_t addresses = 0;        // record links parsed
+    size_t rejected = 0;         // links with an invalid address
+    epicsUInt64 parseNs = 0;
+    size_t variables = 0;        // unique addresses bound to topics
+    epicsUInt64 bindNs = 0;
+    epicsUInt64 initNs = 0;      // monotonic time of iocInit, 0 before it
+    size_t connects = 0;
+    epicsUInt64 connectNs = 0;   // iocInit to first connection
+    size_t subscribedTopics = 0; // last connection
+    epicsUInt64 subscribeNs = 0; // building and sending the subscription request of the last connection
+  };
+  StartupStats startup;
+  MqttTrace trace;
+  MqttErrorLimiter parseErrorLimiter;
+  MqttErrorLimiter opFailLimiter;
   /* autoParam specific methods */
   DeviceAddress* parseDeviceAddress(std::string const& function, std::string const& arguments);
   DeviceVariable* createDeviceVariable(DeviceVariable* baseVar);
+  MqttTopicAddr* parseTopicAddress(std::string const& function, std::string_view arguments);
+  MqttTopicVariable* createTopicVariable(DeviceVariable* baseVar);
   /* helper methods */
-  static const json* findJsonField(const json& payload, const std::string& targetKey);
-  static bool isInteger(const std::string& s, bool isSigned = true);
-  static bool isBoolean(const std::string& s);
-  static bool isFloat(const std::string& s);
   static bool isSign(char character);
   static bool isSupportedTopicType(const std::string& type);
-  static bool isValidTopicName(const std::string& topicName);
-  static asynStatus checkAndParseIntArray(const std::string& s, std::vector<epicsInt32>& out);
-  static asynStatus checkAndParseFloatArray(const std::string& s, std::vector<epicsFloat64>& out);
-};
+  static bool isValidTopicName(std::string_view topicName);
 
-class MqttTopicAddr : public DeviceAddress {
 public:
-  enum TopicFormat { FLAT, JSON };
-
-  TopicFormat format;
-  std::string topicName;
-  std::string jsonField;
-  epicsUInt32 mask = 0xFFFFFFFF;
-  bool operator==(DeviceAddress const& comparedAddr) const;
+  /* payload parsers/formatters - stateless, public so they can be benchmarked */
+  static const json* findJsonField(const json& payload, const std::string& targetKey);
+  /* Document formats (JSON, CBOR, MSGPACK) share the field lookup; the binary ones are decoded with
+     nlohmann's from_cbor/from_msgpack and written as a single-field document */
+  static json decodeDocument(MqttTopicAddr::TopicFormat format, const std::string& payload);
+  static std::string encodeDocument(MqttTopicAddr const& addr, json value);
+  static const char* formatName(MqttTopicAddr::TopicFormat format);
+  static bool isInteger(const std::string& s, bool isSigned = true);
+  static bool isBoolean(const std::string& s);
+  static bool isFloat(const std::string& s);
+  template <typename epicsDataType>
+  static asynStatus checkAndParseIntArray(const std::string& s, std::vector<epicsDataType>& out);
+  template <typename epicsDataType>
+  static asynStatus checkAndParseFloatArray(const std::string& s, std::vector<epicsDataType>& out);
+  /* Text array parser for any supported element type (integer or float) */
+  template <typename epicsDataType>
+  static asynStatus checkAndParseArray(const std::string& s, std::vector<epicsDataType>& out);
+  /* BIN format: packed little-endian elements, no header */
+  template <typename epicsDataType>
+  static asynStatus decodeBinaryArray(const std::string& payload, std::vector<epicsDataType>& out);
+  template <typename epicsDataType>
+  static std::string encodeBinaryArray(const epicsDataType* data, size_t count);
+  template <typename epicsDataType>
+  static std::string formatArray(const epicsDataType* data, size_t count);
 };
 
 class MqttTopicVariable : public DeviceVariable {
@@ -87,6 +315,21 @@ public:
     : DeviceVariable(baseVar), driver(driver) {
   }
   MqttDriver* driver;
+  /* last decoded value in native binary form, kept only when snapshots are enabled */
+  std::string snapshotValue;
+  /* true once snapshotValue holds a value, which may be an empty string or array */
+  bool hasSnapshot = false;
+  /* true while the value is not current (restored from the snapshot, or its Sparkplug
+     node/device went offline) and no fresh message arrived */
+  bool stale = false;
+  /* index of the record in the driver's topicRecords of its topic */
+  size_t topicRecord = 0;
+  /* JSON output records: payload rendered from the address template, reused across writes
+     (array records of every format publish from it) */
+  std::string writeBuffer;
 };
 
+extern "C" int mqttDriverConfigure(const char* portName, const char* brokerUrl, const char* mqttClientID, const int qos,
+  const char* options);
+
 #endif /* DRVMQTT_H */
@@ -0,0 +1,115 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2026 André Favoto
+
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include "mqttCapture.h"
+
+static const char CAPTURE_MAGIC[8] = { 'M', 'Q', 'T', 'T', 'C', 'A', 'P', '1' };
+static const size_t RECORD_HEADER_SIZE = 16;
+
+static void putLE(unsigned char* dst, uint64_t value, size_t bytes) {
+  for (size_t i = 0; i < bytes; i++) dst[i] = static_cast<unsigned char>(value >> (8 * i));
+}
+
+static uint64_t getLE(const unsigned char* src, size_t bytes) {
+  uint64_t value = 0;
+  for (size_t i = 0; i < bytes; i++) value |= static_cast<uint64_t>(src[i]) << (8 * i);
+  return value;
+}
+
+//#############################################################################################
+
+MqttCaptureWriter::~MqttCaptureWriter() {
+  close();
+}
+
+void MqttCaptureWriter::open(const std::string& path) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  if (fp_) fclose(fp_);
+  fp_ = fopen(path.c_str(), "wb");
+  if (!fp_) throw std::runtime_error("Cannot open capture file '" + path + "': " + strerror(errno));
+  count_ = 0;
+  if (fwrite(CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC), 1, fp_) != 1) {
+    fclose(fp_);
+    fp_ = nullptr;
+    throw std::runtime_error("Cannot write capture file '" + path + "'");
+  }
+}
+
+void MqttCaptureWriter::close() {
+  std::lock_guard<std::mutex> guard(mutex_);
+  if (fp_) fclose(fp_);
+  fp_ = nullptr;
+}
+
+bool MqttCaptureWriter::isOpen() {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return fp_ != nullptr;
+}
+
+uint64_t MqttCaptureWriter::recordCount() {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return count_;
+}
+
+void MqttCaptureWriter::write(const std::string& topic, const std::string& payload, int qos, bool retained) {
+  uint64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::system_clock::now().time_since_epoch()).count();
+  unsigned char header[RECORD_HEADER_SIZE];
+  size_t topicLen = topic.size() > 0xFFFF ? 0xFFFF : topic.size();
+  putLE(header, now, 8);
+  header[8] = static_cast<unsigned char>(qos);
+  header[9] = retained ? 1 : 0;
+  putLE(header + 10, topicLen, 2);
+  putLE(header + 12, payload.size(), 4);
+
+  std::lock_guard<std::mutex> guard(mutex_);
+  if (!fp_) return;
+  fwrite(header, sizeof(header), 1, fp_);
+  fwrite(topic.data(), 1, topicLen, fp_);
+  fwrite(payload.data(), 1, payload.size(), fp_);
+  count_++;
+}
+
+//#############################################################################################
+
+MqttCaptureReader::~MqttCaptureReader() {
+  close();
+}
+
+void MqttCaptureReader::open(const std::string& path) {
+  close();
+  fp_ = fopen(path.c_str(), "rb");
+  if (!fp_) throw std::runtime_error("Cannot open capture file '" + path + "': " + strerror(errno));
+  char magic[sizeof(CAPTURE_MAGIC)];
+  if (fread(magic, sizeof(magic), 1, fp_) != 1 || memcmp(magic, CAPTURE_MAGIC, sizeof(magic)) != 0) {
+    close();
+    throw std::runtime_error("'" + path + "' is not an MQTT capture file");
+  }
+}
+
+void MqttCaptureReader::close() {
+  if (fp_) fclose(fp_);
+  fp_ = nullptr;
+}
+
+bool MqttCaptureReader::next(MqttCaptureRecord& record) {
+  if (!fp_) return false;
+  unsigned char header[RECORD_HEADER_SIZE];
+  size_t got = fread(header, 1, sizeof(header), fp_);
+  if (got == 0) return false;
+  if (got != sizeof(header)) throw std::runtime_error("Truncated capture record");
+
+  record.arrivalNs = getLE(header, 8);
+  record.qos = header[8];
+  record.retained = header[9] != 0;
+  record.topic.resize(getLE(header + 10, 2));
+  record.payload.resize(getLE(header + 12, 4));
+  if (fread(&record.topic[0], 1, record.topic.size(), fp_) != record.topic.size() ||
+    fread(&record.payload[0], 1, record.payload.size(), fp_) != record.payload.size())
+    throw std::runtime_error("Truncated capture record");
+  return true;
+}
@@ -0,0 +1,65 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2026 André Favoto
+
+#ifndef MQTTCAPTURE_H
+#define MQTTCAPTURE_H
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+
+/*
+  Compact binary log of received MQTT messages.
+
+  File layout (all integers little-endian):
+
+    header:  8 bytes magic "MQTTCAP1"
+    records: u64 arrival time (ns since the Unix epoch)
+             u8  qos
+             u8  retained flag
+             u16 topic length
+             u32 payload length
+             topic bytes, payload bytes
+*/
+struct MqttCaptureRecord {
+  uint64_t arrivalNs = 0;
+  uint8_t qos = 0;
+  bool retained = false;
+  std::string topic;
+  std::string payload;
+};
+
+class MqttCaptureWriter {
+public:
+  MqttCaptureWriter() {}
+  ~MqttCaptureWriter();
+
+  /* Opens (truncates) the capture file. Throws std::runtime_error on failure. */
+  void open(const std::string& path);
+  void close();
+  bool isOpen();
+  /* Appends a record stamped with the current time. Thread-safe. */
+  void write(const std::string& topic, const std::string& payload, int qos, bool retained);
+  uint64_t recordCount();
+
+private:
+  std::mutex mutex_;
+  FILE* fp_ = nullptr;
+  uint64_t count_ = 0;
+};
+
+class MqttCaptureReader {
+public:
+  MqttCaptureReader() {}
+  ~MqttCaptureReader();
+
+  /* Opens a capture file and checks its header. Throws std::runtime_error on failure. */
+  void open(const std::string& path);
+  void close();
+  /* Reads the next record. Returns false at end of file; throws on a truncated record. */
+  bool next(MqttCaptureRecord& record);
+
+private:
+  FILE* fp_ = nullptr;
+};
+#endif
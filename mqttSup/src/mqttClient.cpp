@@ -6,21 +6,31 @@
   https://github.com/eclipse-paho/paho.mqtt.cpp/tree/master/examples
 */
 
+#include <algorithm>
 #include <cstdio>
+#include <functional>
 #include <stdexcept>
 #include "mqttClient.h"
 
 // TODO: improve overall error handling
 
 MqttClient::MqttClient(const Config& cfg)
-  : client_(cfg.brokerUrl, cfg.clientId), config_(cfg)
+  : config_(cfg),
+  rng_(std::random_device{}() ^ static_cast<unsigned>(std::hash<std::string>{}(cfg.clientId)))
 {
-  client_.set_callback(*this);
+  // file persistence keeps unacknowledged QoS 1/2 messages across restarts
+  if (cfg.persistDir.empty())
+    client_ = std::make_unique<mqtt::async_client>(cfg.brokerUrl, cfg.clientId);
+  else
+    client_ = std::make_unique<mqtt::async_client>(cfg.brokerUrl, cfg.clientId, cfg.persistDir);
+  client_->set_callback(*this);
 
   auto builder = mqtt::connect_options_builder::v5()
     .clean_start(cfg.cleanStart)
     .keep_alive_interval(std::chrono::seconds(cfg.keepAliveInterval))
-    .automatic_reconnect(true);
+    .automatic_reconnect(false); // reconnects are owned by reconnectTask
+  if (!cfg.cleanStart && cfg.sessionExpiry > 0)
+    builder.properties({ mqtt::property(mqtt::property::SESSION_EXPIRY_INTERVAL, cfg.sessionExpiry) });
 
   // TODO: integrate secure connection
   // if (!cfg.sslCaCert.empty()) {
@@ -32,82 +42,130 @@ MqttClient::MqttClient(const Config& cfg)
   // }
 
   connOpts_ = builder.finalize();
+  reconnectThread_ = std::thread(&MqttClient::reconnectTask, this);
 }
 
 MqttClient::~MqttClient() {
+  {
+    std::lock_guard<std::mutex> lock(reconnectMutex_);
+    stopping_ = true;
+  }
+  reconnectCv_.notify_all();
+  reconnectThread_.join();
   try {
     disconnect();
   }
   catch (...) {}
 }
 
-/* Reason string returned if a connection event comes from an auto-reconnect */
+/* Reason strings returned if a connection event comes from the reconnect worker, after a lost
+   connection or after failed attempts of the first connect */
 const char* MqttClient::AUTO_RECONNECT_REASON = "automatic reconnect";
+const char* MqttClient::CONNECT_RETRY_REASON = "connect retry";
 
 void MqttClient::connect() {
-  client_.connect(connOpts_, nullptr, *this);
+  client_->connect(connOpts_, nullptr, *this);
 }
 
 void MqttClient::disconnect() {
-  if (client_.is_connected()) {
-    client_.disconnect()->wait();
+  if (client_->is_connected()) {
+    client_->disconnect()->wait();
   }
 }
 
 void MqttClient::reconnect() {
-  if (!client_.is_connected()) {
-    client_.reconnect();
+  {
+    std::lock_guard<std::mutex> lock(reconnectMutex_);
+    reconnectPending_ = true;
   }
+  reconnectCv_.notify_one();
 }
 
-void MqttClient::subscribe(const std::string& topic) {
-  if (client_.is_connected())
-    client_.subscribe(topic, config_.qos, nullptr, *this);
-  else
-    throw std::runtime_error("MQTT client not connected");
+/* Applies the jitter to the current backoff delay, in seconds */
+double MqttClient::nextDelay(double backoff) {
+  std::uniform_real_distribution<double> dist(0, config_.reconnectJitter);
+  return backoff * (1 - dist(rng_));
 }
 
-void MqttClient::publish(const std::string& topic, const std::string& payload, int qos, bool retained) {
-  if (!client_.is_connected())
-    throw std::runtime_error("MQTT client not connected");
-
-  int q = qos >= 0 ? qos : config_.qos;
-  client_.publish(topic, payload.c_str(), payload.size(), q, retained, nullptr, *this);
+/*
+  Single owner of the reconnect path: waits for reconnect() requests and
+  retries with exponential backoff until the client is connected again.
+  Requests arriving while an attempt is running are merged into it.
+*/
+void MqttClient::reconnectTask() {
+  std::unique_lock<std::mutex> lock(reconnectMutex_);
+  for (;;) {
+    reconnectCv_.wait(lock, [this] { return reconnectPending_ || stopping_; });
+    if (stopping_) return;
+    reconnectPending_ = false;
+
+    double backoff = config_.reconnectMinDelay;
+    while (!client_->is_connected()) {
+      auto delay = std::chrono::duration<double>(nextDelay(backoff));
+      if (reconnectCv_.wait_for(lock, delay, [this] { return stopping_; })) return;
+      if (client_->is_connected()) break;
+      lock.unlock();
+      try {
+        reconnecting_ = true;
+        client_->connect(connOpts_, nullptr, *this)->wait();
+      }
+      catch (const std::exception&) {
+        // failure already reported through on_failure
+        reconnecting_ = false;
+      }
+      lock.lock();
+      backoff = std::min(backoff * 2, config_.reconnectMaxDelay);
+    }
+    reconnectPending_ = false;
+  }
 }
 
-void MqttClient::setConnectionCb(ConnectionCallback cb) {
-  connectionCb_ = std::move(cb);
+void MqttClient::subscribe(const std::string& topic) {
+  if (client_->is_connected())
+    client_->subscribe(topic, config_.qos, nullptr, *this);
+  else
+    throw std::runtime_error("MQTT client not connected");
 }
 
-/* Set callback for "connection_lost" event.
-
-  NOTE: reconnect() is called by default if no disconnection callback is set.
-  If a disconnection callback is set, is up to the user to call the reconnect
-  routine as needed.
-*/
-void MqttClient::setDisconnectionCb(DisconnectionCallback cb) {
-  disconnectionCb_ = std::move(cb);
+void MqttClient::subscribe(const std::vector<std::string>& topics) {
+  if (topics.empty()) return;
+  if (!client_->is_connected())
+    throw std::runtime_error("MQTT client not connected");
+  auto filters = mqtt::string_collection::create(topics);
+  client_->subscribe(filters, std::vector<int>(topics.size(), config_.qos), nullptr, *this);
 }
 
-void MqttClient::setMessageCb(MessageCallback cb) {
-  messageCb_ = std::move(cb);
+void MqttClient::resubscribe(const std::vector<std::string>& topics) {
+  if (topics.empty()) return;
+  if (!client_->is_connected())
+    throw std::runtime_error("MQTT client not connected");
+  auto filters = mqtt::string_collection::create(topics);
+  // subscriptions already in the session do not get their retained messages again
+  std::vector<mqtt::subscribe_options> opts(topics.size(),
+    mqtt::subscribe_options(false, false, mqtt::subscribe_options::SEND_RETAINED_ON_NEW));
+  client_->subscribe(filters, std::vector<int>(topics.size(), config_.qos), nullptr, *this, opts);
 }
 
-void MqttClient::setPublishCb(PublishCallback cb) {
-  publishCb_ = std::move(cb);
+void MqttClient::unsubscribe(const std::string& topic) {
+  if (!client_->is_connected())
+    throw std::runtime_error("MQTT client not connected");
+  client_->unsubscribe(topic, nullptr, *this);
 }
 
-void MqttClient::setOpFailCb(OpFailCallback cb) {
-  opFailCb_ = std::move(cb);
-}
+void MqttClient::publish(const std::string& topic, const std::string& payload, int qos, bool retained) {
+  if (!client_->is_connected())
+    throw std::runtime_error("MQTT client not connected");
 
-void MqttClient::setSubscriptionCb(SubscriptionCallback cb) {
-  subscriptionCb_ = std::move(cb);
+  int q = qos >= 0 ? qos : config_.qos;
+  client_->publish(topic, payload.c_str(), payload.size(), q, retained, nullptr, *this);
 }
 
 // --- mqtt::callback implementations ---
 
-void MqttClient::connected(const std::string& reason) {
+void MqttClient::connected(const std::string& cause) {
+  bool retried = reconnecting_.exchange(false);
+  bool first = !wasConnected_.exchange(true);
+  std::string reason = !retried ? cause : first ? CONNECT_RETRY_REASON : AUTO_RECONNECT_REASON;
   if (connectionCb_) {
     connectionCb_(reason);
   }
@@ -129,6 +187,7 @@ void MqttClient::connection_lost(const std::string& reason) {
 }
 
 void MqttClient::message_arrived(mqtt::const_message_ptr msg) {
+  capture(msg->get_topic(), msg->get_payload_str(), msg->get_qos(), msg->is_retained());
   if (messageCb_) {
     messageCb_(msg->get_topic(), msg->to_string());
   }
@@ -143,13 +202,20 @@ void MqttClient::message_arrived(mqtt::const_message_ptr msg) {
 // --- mqtt::iaction_listener implementations ---
 
 void MqttClient::on_success(const mqtt::token& tok) {
-  if (tok.get_type() == mqtt::token::Type::SUBSCRIBE) {
-    auto topic = (*tok.get_topics())[0];
-    if (subscriptionCb_) {
-      subscriptionCb_(topic);
-    }
-    else {
-      fprintf(stdout, "%s: Subscribed to '%s'\n", moduleName, topic.c_str());
+  if (tok.get_type() == mqtt::token::Type::CONNECT) {
+    // Paho completes the connect token before calling connected()
+    sessionPresent_ = tok.get_connect_response().is_session_present();
+  }
+  else if (tok.get_type() == mqtt::token::Type::SUBSCRIBE) {
+    // bulk subscriptions complete with a single token for all topics
+    auto topics = tok.get_topics();
+    for (size_t i = 0; topics && i < topics->size(); i++) {
+      if (subscriptionCb_) {
+        subscriptionCb_((*topics)[i]);
+      }
+      else {
+        fprintf(stdout, "%s: Subscribed to '%s'\n", moduleName, (*topics)[i].c_str());
+      }
     }
   }
   else if (tok.get_type() == mqtt::token::Type::PUBLISH) {
@@ -171,4 +237,6 @@ void MqttClient::on_failure(const mqtt::token& tok) {
   else {
     fprintf(stderr, "%s: %s", moduleName, errorMsg.c_str());
   }
+  // the first connect can fail too (e.g. broker down at IOC start): keep trying
+  if (tok.get_type() == mqtt::token::Type::CONNECT) reconnect();
 }
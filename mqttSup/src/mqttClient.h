@@ -7,58 +7,53 @@
 #include <string>
 #include <functional>
 #include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <random>
+#include "mqttTransport.h"
 
-class MqttClient : public virtual mqtt::callback, public virtual mqtt::iaction_listener {
+class MqttClient : public MqttTransport, public virtual mqtt::callback, public virtual mqtt::iaction_listener {
 public:
-  struct Config {
-    std::string brokerUrl = "mqtt://localhost:1883";
-    std::string clientId = "MqttClient";
-    int qos = 1;
-    int keepAliveInterval = 20;
-    bool cleanStart = true;
+  using Config = MqttTransport::Config;
 
-    // For future SSL support
-    std::string sslCaCert;
-    std::string sslCert;
-    std::string sslKey;
-  };
   MqttClient(const Config& cfg);
   ~MqttClient();
 
-  using ConnectionCallback = std::function<void(const std::string& reason)>;
-  using DisconnectionCallback = std::function<void(const std::string& reason)>;
-  using MessageCallback = std::function<void(const std::string& topic, const std::string& payload)>;
-  using SubscriptionCallback = std::function<void(const std::string& topic)>;
-  using PublishCallback = std::function<void(const std::string& topic)>;
-  using OpFailCallback = std::function<void(const std::string& message)>;
-
-  void connect();
-  void disconnect();
-  void reconnect();
-  void subscribe(const std::string& topic);
-  void publish(const std::string& topic, const std::string& payload, int qos = -1, bool retained = false);
-
-  void setConnectionCb(ConnectionCallback cb);
-  void setDisconnectionCb(DisconnectionCallback cb);
-  void setMessageCb(MessageCallback cb);
-  void setSubscriptionCb(SubscriptionCallback cb);
-  void setPublishCb(PublishCallback cb);
-  void setOpFailCb(OpFailCallback cb);
+  void connect() override;
+  void disconnect() override;
+  /* Requests a reconnect. Attempts are made by a single worker thread
+     following the reconnect policy in Config, so at most one is in flight. */
+  void reconnect() override;
+  void subscribe(const std::string& topic) override;
+  void subscribe(const std::vector<std::string>& topics) override;
+  void resubscribe(const std::vector<std::string>& topics) override;
+  void unsubscribe(const std::string& topic) override;
+  void publish(const std::string& topic, const std::string& payload, int qos = -1, bool retained = false) override;
+  bool sessionPresent() const override { return sessionPresent_; }
 
   static const char* AUTO_RECONNECT_REASON;
+  static const char* CONNECT_RETRY_REASON;
 
 private:
   int nretry_;
   const char* moduleName = "pahoMqttClient";
-  mqtt::async_client client_;
+  std::unique_ptr<mqtt::async_client> client_;
   mqtt::connect_options connOpts_;
   Config config_;
-  MessageCallback messageCb_;
-  ConnectionCallback connectionCb_;
-  DisconnectionCallback disconnectionCb_;
-  OpFailCallback opFailCb_;
-  SubscriptionCallback subscriptionCb_;
-  PublishCallback publishCb_;
+  std::atomic<bool> sessionPresent_{ false };
+
+  // Reconnect worker
+  std::mutex reconnectMutex_;
+  std::condition_variable reconnectCv_;
+  bool reconnectPending_ = false;
+  bool stopping_ = false;
+  std::atomic<bool> reconnecting_{ false };
+  std::atomic<bool> wasConnected_{ false }; // a connection was made before, retries are reconnects
+  std::mt19937 rng_;
+  std::thread reconnectThread_;
+  void reconnectTask();
+  double nextDelay(double backoff);
 
   // Callbacks
   void connected(const std::string& cause) override;
@@ -0,0 +1,219 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2026 André Favoto
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#ifdef MQTT_WITH_ZLIB
+#include <zlib.h>
+#endif
+#ifdef MQTT_WITH_LZ4
+#include <lz4frame.h>
+#endif
+#ifdef MQTT_WITH_ZSTD
+#include <zstd.h>
+#endif
+#include "mqttCodec.h"
+
+const std::vector<MqttCodec>& mqttCodecsAvailable() {
+  static const std::vector<MqttCodec> codecs = {
+#ifdef MQTT_WITH_ZLIB
+    MQTT_CODEC_ZLIB,
+#endif
+#ifdef MQTT_WITH_LZ4
+    MQTT_CODEC_LZ4,
+#endif
+#ifdef MQTT_WITH_ZSTD
+    MQTT_CODEC_ZSTD,
+#endif
+  };
+  return codecs;
+}
+
+const char* mqttCodecName(MqttCodec codec) {
+  switch (codec) {
+    case MQTT_CODEC_NONE: return "none";
+    case MQTT_CODEC_ZLIB: return "zlib";
+    case MQTT_CODEC_LZ4: return "lz4";
+    case MQTT_CODEC_ZSTD: return "zstd";
+  }
+  return "unknown";
+}
+
+MqttCodec mqttCodecFromName(const std::string& name) {
+  for (MqttCodec codec : mqttCodecsAvailable()) {
+    if (name == mqttCodecName(codec)) return codec;
+  }
+  throw std::invalid_argument("Unknown or unavailable codec: " + name);
+}
+
+#if defined(MQTT_WITH_ZLIB) || defined(MQTT_WITH_LZ4) || defined(MQTT_WITH_ZSTD)
+static void tooLarge(size_t maxSize) {
+  throw std::runtime_error("Decompressed payload exceeds " + std::to_string(maxSize) + " bytes");
+}
+
+/* Sizes the output buffer of a streaming decoder before the first call: the content size if the
+   frame header gives it, else a few times the input */
+static void sizeOutput(std::string& out, const std::string& in, size_t contentSize, bool known, size_t maxSize) {
+  if (known && contentSize > maxSize) tooLarge(maxSize);
+  size_t size = known ? std::max<size_t>(contentSize, 1) : std::max<size_t>(in.size() * 4, 4096);
+  out.resize(std::min(size, maxSize));
+}
+
+/* Doubles the output buffer of a streaming decoder, up to maxSize */
+static void growOutput(std::string& out, size_t maxSize) {
+  if (out.size() >= maxSize) tooLarge(maxSize);
+  out.resize(std::min(std::max<size_t>(out.size() * 2, 4096), maxSize));
+}
+
+static void truncatedInput() {
+  throw std::runtime_error("Truncated compressed payload");
+}
+#endif
+
+//#############################################################################################
+
+void mqttCompress(MqttCodec codec, const std::string& in, std::string& out) {
+  switch (codec) {
+#ifdef MQTT_WITH_ZLIB
+    case MQTT_CODEC_ZLIB:
+    {
+      uLongf size = compressBound(in.size());
+      out.resize(size);
+      int ret = compress2(reinterpret_cast<Bytef*>(&out[0]), &size,
+        reinterpret_cast<const Bytef*>(in.data()), in.size(), Z_DEFAULT_COMPRESSION);
+      if (ret != Z_OK) throw std::runtime_error("zlib compression failed: " + std::to_string(ret));
+      out.resize(size);
+      return;
+    }
+#endif
+#ifdef MQTT_WITH_LZ4
+    case MQTT_CODEC_LZ4:
+    {
+      LZ4F_preferences_t prefs;
+      memset(&prefs, 0, sizeof(prefs));
+      prefs.frameInfo.contentSize = in.size(); // lets decoders size their buffer up front
+      out.resize(LZ4F_compressFrameBound(in.size(), &prefs));
+      size_t size = LZ4F_compressFrame(&out[0], out.size(), in.data(), in.size(), &prefs);
+      if (LZ4F_isError(size)) throw std::runtime_error(std::string("LZ4 compression failed: ") + LZ4F_getErrorName(size));
+      out.resize(size);
+      return;
+    }
+#endif
+#ifdef MQTT_WITH_ZSTD
+    case MQTT_CODEC_ZSTD:
+    {
+      out.resize(ZSTD_compressBound(in.size()));
+      size_t size = ZSTD_compress(&out[0], out.size(), in.data(), in.size(), ZSTD_CLEVEL_DEFAULT);
+      if (ZSTD_isError(size)) throw std::runtime_error(std::string("zstd compression failed: ") + ZSTD_getErrorName(size));
+      out.resize(size);
+      return;
+    }
+#endif
+    case MQTT_CODEC_NONE:
+      out = in;
+      return;
+    default:
+      break;
+  }
+  throw std::runtime_error(std::string("Codec not available: ") + mqttCodecName(codec));
+}
+
+/*
+  Streaming decoders write into out, which starts at the content size of the
+  frame when its header has it (LZ4 frames from mqttCompress, zstd frames),
+  else at a few times the input, and doubles as needed. Sizing from the
+  message, not from the capacity, keeps small payloads cheap after a large
+  one; the capacity is still reused, so a buffer kept across calls stops
+  allocating once it fits the largest payload.
+*/
+void mqttDecompress(MqttCodec codec, const std::string& in, std::string& out, size_t maxSize) {
+  if (codec == MQTT_CODEC_NONE) {
+    out.assign(in);
+    return;
+  }
+  out.clear();
+  size_t produced = 0;
+  switch (codec) {
+#ifdef MQTT_WITH_ZLIB
+    case MQTT_CODEC_ZLIB:
+    {
+      z_stream zs;
+      memset(&zs, 0, sizeof(zs));
+      if (inflateInit(&zs) != Z_OK) throw std::runtime_error("zlib initialization failed");
+      std::unique_ptr<z_stream, int(*)(z_stream*)> guard(&zs, inflateEnd);
+      sizeOutput(out, in, 0, false, maxSize); // zlib streams do not record their size
+      zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in.data()));
+      zs.avail_in = in.size();
+      for (;;) {
+        zs.next_out = reinterpret_cast<Bytef*>(&out[produced]);
+        zs.avail_out = out.size() - produced;
+        int ret = inflate(&zs, Z_NO_FLUSH);
+        produced = zs.total_out;
+        if (ret == Z_STREAM_END) break;
+        if (ret != Z_OK && ret != Z_BUF_ERROR)
+          throw std::runtime_error(std::string("zlib decompression failed: ") + (zs.msg ? zs.msg : std::to_string(ret)));
+        if (produced == out.size()) growOutput(out, maxSize);
+        else if (zs.avail_in == 0) truncatedInput();
+      }
+      break;
+    }
+#endif
+#ifdef MQTT_WITH_LZ4
+    case MQTT_CODEC_LZ4:
+    {
+      LZ4F_dctx* dctx;
+      size_t ret = LZ4F_createDecompressionContext(&dctx, LZ4F_VERSION);
+      if (LZ4F_isError(ret)) throw std::runtime_error(std::string("LZ4 initialization failed: ") + LZ4F_getErrorName(ret));
+      std::unique_ptr<LZ4F_dctx, LZ4F_errorCode_t(*)(LZ4F_dctx*)> guard(dctx, LZ4F_freeDecompressionContext);
+      const char* src = in.data();
+      size_t srcLeft = in.size();
+      LZ4F_frameInfo_t info;
+      size_t srcSize = srcLeft;
+      ret = LZ4F_getFrameInfo(dctx, &info, src, &srcSize); // consumes the frame header
+      if (LZ4F_isError(ret)) throw std::runtime_error(std::string("LZ4 decompression failed: ") + LZ4F_getErrorName(ret));
+      src += srcSize;
+      srcLeft -= srcSize;
+      sizeOutput(out, in, info.contentSize, info.contentSize != 0, maxSize);
+      for (;;) {
+        size_t dstSize = out.size() - produced;
+        size_t srcSize = srcLeft;
+        ret = LZ4F_decompress(dctx, &out[produced], &dstSize, src, &srcSize, nullptr);
+        if (LZ4F_isError(ret)) throw std::runtime_error(std::string("LZ4 decompression failed: ") + LZ4F_getErrorName(ret));
+        produced += dstSize;
+        src += srcSize;
+        srcLeft -= srcSize;
+        if (ret == 0) break; // end of frame
+        if (produced == out.size()) growOutput(out, maxSize);
+        else if (srcLeft == 0) truncatedInput();
+      }
+      break;
+    }
+#endif
+#ifdef MQTT_WITH_ZSTD
+    case MQTT_CODEC_ZSTD:
+    {
+      std::unique_ptr<ZSTD_DStream, size_t(*)(ZSTD_DStream*)> stream(ZSTD_createDStream(), ZSTD_freeDStream);
+      if (!stream || ZSTD_isError(ZSTD_initDStream(stream.get()))) throw std::runtime_error("zstd initialization failed");
+      unsigned long long contentSize = ZSTD_getFrameContentSize(in.data(), in.size());
+      bool known = contentSize != ZSTD_CONTENTSIZE_UNKNOWN && contentSize != ZSTD_CONTENTSIZE_ERROR;
+      sizeOutput(out, in, known ? contentSize : 0, known, maxSize);
+      ZSTD_inBuffer input = { in.data(), in.size(), 0 };
+      for (;;) {
+        ZSTD_outBuffer output = { &out[produced], out.size() - produced, 0 };
+        size_t ret = ZSTD_decompressStream(stream.get(), &output, &input);
+        if (ZSTD_isError(ret)) throw std::runtime_error(std::string("zstd decompression failed: ") + ZSTD_getErrorName(ret));
+        produced += output.pos;
+        if (ret == 0) break; // end of frame
+        if (produced == out.size()) growOutput(out, maxSize);
+        else if (input.pos == input.size) truncatedInput();
+      }
+      break;
+    }
+#endif
+    default:
+      throw std::runtime_error(std::string("Codec not available: ") + mqttCodecName(codec));
+  }
+  out.resize(produced);
+}
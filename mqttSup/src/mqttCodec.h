@@ -0,0 +1,48 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2026 André Favoto
+
+#ifndef MQTTCODEC_H
+#define MQTTCODEC_H
+#include <string>
+#include <vector>
+
+/*! \brief Payload compression codecs.
+ *
+ * Selected per record with a suffix on the array types (e.g.
+ * "FLAT:FLOATARRAY:lz4"): inbound payloads are decompressed before parsing
+ * and outbound ones compressed after formatting. Each codec uses the
+ * standard self-describing container of its library, so payloads can be
+ * produced/consumed by the usual tools and language bindings:
+ *
+ *   zlib  zlib stream (RFC 1950), e.g. Python zlib.compress
+ *   lz4   LZ4 frame, e.g. Python lz4.frame.compress, `lz4` CLI
+ *   zstd  Zstandard frame, e.g. Python zstandard, `zstd` CLI
+ *
+ * The libraries are optional; see WITH_ZLIB/WITH_LZ4/WITH_ZSTD in
+ * configure/CONFIG_SITE. Codecs not built in are not accepted in record links.
+ */
+enum MqttCodec {
+  MQTT_CODEC_NONE,
+  MQTT_CODEC_ZLIB,
+  MQTT_CODEC_LZ4,
+  MQTT_CODEC_ZSTD
+};
+
+/* Upper bound of a decompressed payload, protects against decompression bombs */
+static const size_t MQTT_CODEC_MAX_DECODED_SIZE = 64 * 1024 * 1024;
+
+/* Codecs built into this library, excluding MQTT_CODEC_NONE */
+const std::vector<MqttCodec>& mqttCodecsAvailable();
+/* Suffix name used in record links ("zlib", "lz4", "zstd") */
+const char* mqttCodecName(MqttCodec codec);
+/* Throws std::invalid_argument on unknown or unavailable codecs */
+MqttCodec mqttCodecFromName(const std::string& name);
+
+/* Replaces out with the compressed data. Throws std::runtime_error on codec errors. */
+void mqttCompress(MqttCodec codec, const std::string& in, std::string& out);
+/* Replaces out with the decompressed data, reusing its capacity. Throws
+   std::runtime_error on corrupt input or if the result exceeds maxSize. */
+void mqttDecompress(MqttCodec codec, const std::string& in, std::string& out,
+  size_t maxSize = MQTT_CODEC_MAX_DECODED_SIZE);
+
+#endif
@@ -0,0 +1,153 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2026 André Favoto
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include <epicsEndian.h>
+#include <epicsTime.h>
+#include <pv/pvData.h>
+#include <pv/ntndarray.h>
+#include <pva/server.h>
+#include <pva/sharedstate.h>
+#include "mqttImage.h"
+
+namespace pvd = epics::pvData;
+namespace pva = epics::pvAccess;
+
+struct MqttImageServer::Channel {
+  std::string pvName;
+  pvas::SharedPV::shared_pointer pv;
+  pvd::int32 uniqueId = 0;
+};
+
+struct MqttImageServer::Impl {
+  explicit Impl(const std::string& name) : provider(name) {}
+  pvas::StaticProvider provider;
+  pvd::StructureConstPtr type;
+  std::unordered_map<std::string, Channel> channels; // by topic
+};
+
+static epicsUInt16 readU16(const char* p) {
+  return static_cast<epicsUInt16>(static_cast<epicsUInt8>(p[0]) | (static_cast<epicsUInt8>(p[1]) << 8));
+}
+
+/* Copies the pixels into a frozen vector for the NTNDArray value union */
+template <typename PVArrayType>
+static pvd::PVFieldPtr makePixels(const char* data, size_t count) {
+  typedef typename PVArrayType::const_svector::value_type ConstElement;
+  typedef typename std::remove_const<ConstElement>::type Element;
+  pvd::shared_vector<Element> pixels(count);
+  memcpy(pixels.data(), data, count * sizeof(Element));
+#if EPICS_BYTE_ORDER == EPICS_ENDIAN_BIG
+  for (size_t i = 0; i < count; i++) {
+    char* bytes = reinterpret_cast<char*>(&pixels[i]);
+    std::reverse(bytes, bytes + sizeof(Element));
+  }
+#endif
+  auto array = pvd::getPVDataCreate()->createPVScalarArray<PVArrayType>();
+  array->replace(pvd::freeze(pixels));
+  return array;
+}
+
+static void putTimeStamp(const pvd::PVStructurePtr& field, const epicsTimeStamp& now) {
+  field->getSubFieldT<pvd::PVLong>("secondsPastEpoch")->put(now.secPastEpoch + POSIX_TIME_AT_EPICS_EPOCH);
+  field->getSubFieldT<pvd::PVInt>("nanoseconds")->put(now.nsec);
+}
+
+//#############################################################################################
+
+MqttImageServer::MqttImageServer(const std::string& providerName)
+  : impl_(new Impl(providerName)) {
+  impl_->type = epics::nt::NTNDArray::createBuilder()->addTimeStamp()->addAlarm()->createStructure();
+  pva::ChannelProviderRegistry::servers()->addSingleton(impl_->provider.provider());
+}
+
+MqttImageServer::~MqttImageServer() {
+  for (auto& entry : impl_->channels) entry.second.pv->close(true);
+}
+
+void MqttImageServer::addImage(const std::string& pvName, const std::string& topic) {
+  if (impl_->channels.count(topic))
+    throw std::invalid_argument("Topic '" + topic + "' is already an image topic");
+  for (const auto& entry : impl_->channels) {
+    if (entry.second.pvName == pvName)
+      throw std::invalid_argument("PV '" + pvName + "' already exists");
+  }
+  Channel channel;
+  channel.pvName = pvName;
+  channel.pv = pvas::SharedPV::buildReadOnly();
+  channel.pv->open(*pvd::getPVDataCreate()->createPVStructure(impl_->type));
+  impl_->provider.add(pvName, channel.pv);
+  impl_->channels.emplace(topic, std::move(channel));
+}
+
+std::vector<std::string> MqttImageServer::topics() const {
+  std::vector<std::string> out;
+  for (const auto& entry : impl_->channels) out.push_back(entry.first);
+  return out;
+}
+
+bool MqttImageServer::post(const std::string& topic, const std::string& payload) {
+  auto found = impl_->channels.find(topic);
+  if (found == impl_->channels.end()) return false;
+  Channel& channel = found->second;
+
+  if (payload.size() < HEADER_SIZE) throw std::invalid_argument("Image frame shorter than its header");
+  const char* header = payload.data();
+  epicsUInt16 width = readU16(header);
+  epicsUInt16 height = readU16(header + 2);
+  epicsUInt8 dataType = static_cast<epicsUInt8>(header[4]);
+  // reserved for later layouts, which this decoder would misread
+  if (header[5] || header[6] || header[7]) throw std::invalid_argument("Image frame has nonzero reserved header bytes");
+  size_t elementSize;
+  switch (dataType) {
+    case DT_UINT8: case DT_INT8: elementSize = 1; break;
+    case DT_UINT16: case DT_INT16: elementSize = 2; break;
+    case DT_FLOAT32: elementSize = 4; break;
+    default: throw std::invalid_argument("Unknown image data type " + std::to_string(dataType));
+  }
+  size_t count = static_cast<size_t>(width) * height;
+  if (payload.size() != HEADER_SIZE + count * elementSize)
+    throw std::invalid_argument("Image frame size does not match " + std::to_string(width) + "x" + std::to_string(height));
+
+  const char* pixelData = payload.data() + HEADER_SIZE;
+  pvd::PVFieldPtr pixels;
+  const char* unionField;
+  switch (dataType) {
+    case DT_UINT8: pixels = makePixels<pvd::PVUByteArray>(pixelData, count); unionField = "ubyteValue"; break;
+    case DT_UINT16: pixels = makePixels<pvd::PVUShortArray>(pixelData, count); unionField = "ushortValue"; break;
+    case DT_INT8: pixels = makePixels<pvd::PVByteArray>(pixelData, count); unionField = "byteValue"; break;
+    case DT_INT16: pixels = makePixels<pvd::PVShortArray>(pixelData, count); unionField = "shortValue"; break;
+    default: pixels = makePixels<pvd::PVFloatArray>(pixelData, count); unionField = "floatValue"; break;
+  }
+
+  pvd::PVStructurePtr value = pvd::getPVDataCreate()->createPVStructure(impl_->type);
+  value->getSubFieldT<pvd::PVUnion>("value")->set(unionField, pixels);
+
+  pvd::PVStructureArrayPtr dimensionField = value->getSubFieldT<pvd::PVStructureArray>("dimension");
+  pvd::PVStructureArray::svector dimensions(2);
+  const epicsUInt16 sizes[] = { width, height };
+  for (size_t i = 0; i < 2; i++) {
+    dimensions[i] = pvd::getPVDataCreate()->createPVStructure(dimensionField->getStructureArray()->getStructure());
+    dimensions[i]->getSubFieldT<pvd::PVInt>("size")->put(sizes[i]);
+    dimensions[i]->getSubFieldT<pvd::PVInt>("fullSize")->put(sizes[i]);
+    dimensions[i]->getSubFieldT<pvd::PVInt>("binning")->put(1);
+  }
+  dimensionField->replace(pvd::freeze(dimensions));
+
+  pvd::int64 bytes = static_cast<pvd::int64>(count * elementSize);
+  value->getSubFieldT<pvd::PVLong>("compressedSize")->put(bytes);
+  value->getSubFieldT<pvd::PVLong>("uncompressedSize")->put(bytes);
+  value->getSubFieldT<pvd::PVInt>("uniqueId")->put(++channel.uniqueId);
+  epicsTimeStamp now;
+  epicsTimeGetCurrent(&now);
+  putTimeStamp(value->getSubFieldT<pvd::PVStructure>("timeStamp"), now);
+  putTimeStamp(value->getSubFieldT<pvd::PVStructure>("dataTimeStamp"), now);
+
+  pvd::BitSet changed;
+  changed.set(0); // whole structure
+  channel.pv->post(*value, changed);
+  return true;
+}
@@ -0,0 +1,60 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2026 André Favoto
+
+#ifndef MQTTIMAGE_H
+#define MQTTIMAGE_H
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <epicsTypes.h>
+
+/*! \brief Serves binary image topics as NTNDArray PVs over PVA.
+ *
+ * Each image topic is bound to a PV name. Frames are published on the topic
+ * as a small little-endian header followed by the raw pixels:
+ *
+ *   offset  size  field
+ *   0       2     width  (uint16)
+ *   2       2     height (uint16)
+ *   4       1     data type (see DataType)
+ *   5       3     reserved, must be 0 (frames with other values are rejected)
+ *   8       ...   width * height pixels, row-major, little-endian
+ *
+ * Pixels are copied once into the NTNDArray value union, with no per-pixel
+ * conversion. The PVs are served by a pvas::StaticProvider registered in the
+ * PVA server provider registry, so they are reachable through the same PVA
+ * server QSRV uses.
+ *
+ * Images must be added before iocInit (before the PVA server starts); the
+ * topic table is read-only afterwards, so post() needs no locking.
+ */
+class MqttImageServer {
+public:
+  enum DataType : epicsUInt8 {
+    DT_UINT8 = 1,
+    DT_UINT16 = 2,
+    DT_INT8 = 3,
+    DT_INT16 = 4,
+    DT_FLOAT32 = 5
+  };
+  static const size_t HEADER_SIZE = 8;
+
+  /* providerName must be unique among the registered PVA providers */
+  explicit MqttImageServer(const std::string& providerName);
+  ~MqttImageServer();
+
+  /* Binds topic to a new NTNDArray PV. Throws std::invalid_argument if the
+     topic or PV name is already used. */
+  void addImage(const std::string& pvName, const std::string& topic);
+  /* Decodes a frame and posts it to the PV bound to topic. Returns false if
+     topic is not an image topic; throws std::invalid_argument on malformed frames. */
+  bool post(const std::string& topic, const std::string& payload);
+  std::vector<std::string> topics() const;
+
+private:
+  struct Channel;
+  struct Impl;
+  std::unique_ptr<Impl> impl_;
+};
+#endif
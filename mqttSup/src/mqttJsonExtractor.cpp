@@ -0,0 +1,584 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2026 André Favoto
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <stdexcept>
+#ifdef MQTT_WITH_SIMDJSON
+#include <simdjson.h>
+#endif
+#include "mqttJsonExtractor.h"
+#include "mqttJsonTemplate.h"
+
+using json = nlohmann::json;
+
+bool MqttJsonPath::keysOnly() const {
+  for (const Step& step : steps) {
+    if (step.kind != Step::KEY) return false;
+  }
+  return true;
+}
+
+MqttJsonPath MqttJsonPath::parse(const std::string& field) {
+  auto fail = [&field](const char* reason) {
+    throw std::invalid_argument("Invalid field path '" + field + "': " + reason);
+  };
+  auto parseIndex = [&fail](const std::string& digits) {
+    if (digits.empty() || digits.find_first_not_of("0123456789") != std::string::npos) fail("expected an index");
+    errno = 0;
+    unsigned long long index = strtoull(digits.c_str(), nullptr, 10);
+    if (errno == ERANGE || index >= SIZE_MAX) fail("index out of range");
+    return static_cast<size_t>(index);
+  };
+
+  MqttJsonPath path;
+  size_t pos = 0;
+  if (field.compare(0, 1, "$") == 0) {
+    if (field.size() == 1) fail("empty path");
+    path.anchored = true;
+    pos = field[1] == '.' ? 2 : 1;
+  }
+  for (;;) {
+    size_t end = field.find_first_of(".[", pos);
+    if (end == std::string::npos) end = field.size();
+    // "a..b" keeps an empty key, as before paths had indices
+    if (end > pos || end == field.size() || field[end] == '.')
+      path.steps.push_back({ Step::KEY, field.substr(pos, end - pos) });
+    pos = end;
+    while (pos < field.size() && field[pos] == '[') {
+      size_t close = field.find(']', pos);
+      if (close == std::string::npos) fail("missing ']'");
+      std::string inside = field.substr(pos + 1, close - pos - 1);
+      Step step;
+      size_t colon = inside.find(':');
+      if (colon == std::string::npos) {
+        step.kind = Step::INDEX;
+        step.begin = parseIndex(inside);
+      }
+      else {
+        step.kind = Step::SLICE;
+        step.begin = colon == 0 ? 0 : parseIndex(inside.substr(0, colon));
+        step.end = colon + 1 == inside.size() ? SIZE_MAX : parseIndex(inside.substr(colon + 1));
+        if (step.end <= step.begin) fail("empty slice");
+      }
+      path.steps.push_back(step);
+      pos = close + 1;
+    }
+    if (pos >= field.size()) break;
+    if (field[pos] != '.') fail("expected '.' or '[' after ']'");
+    pos++;
+  }
+  for (size_t i = 0; i + 1 < path.steps.size(); i++) {
+    if (path.steps[i].kind == Step::SLICE) fail("a slice must be the last step");
+  }
+  if (path.steps.size() == 1 && path.isSlice()) path.anchored = true; // a bare slice addresses the root array
+  return path;
+}
+
+//#############################################################################################
+
+static MqttJsonNumber makeNumber(MqttJsonNumber::Kind kind) {
+  MqttJsonNumber number;
+  number.kind = kind;
+  return number;
+}
+
+/*
+  SAX handler: keeps the chain of open containers and their current keys or
+  element indices, resolves the paths whose steps match the end of that
+  chain, and copies the events of matched containers into their values. Returning false stops
+  the parser, which happens once every path was found. The simdjson
+  backend walks its documents and drives the same events.
+*/
+class MqttJsonExtractor::Sax {
+public:
+  explicit Sax(MqttJsonExtractor& ex) : ex(ex) {}
+
+  bool null() {
+    return scalar(true, [](std::string& out, bool) { out += "null"; });
+  }
+  bool boolean(bool val) {
+    return scalar(false, [val](std::string& out, bool) { out += val ? "true" : "false"; });
+  }
+  bool number_integer(json::number_integer_t val) {
+    MqttJsonNumber number = makeNumber(MqttJsonNumber::INTEGER);
+    number.integer = val;
+    return scalar(false, [val](std::string& out, bool) { mqttJsonAppendInteger(out, val); }, &number);
+  }
+  bool number_unsigned(json::number_unsigned_t val) {
+    MqttJsonNumber number = makeNumber(MqttJsonNumber::UNSIGNED);
+    number.uinteger = val;
+    return scalar(false, [val](std::string& out, bool) { mqttJsonAppendUnsigned(out, val); }, &number);
+  }
+  bool number_float(json::number_float_t val, const json::string_t&) {
+    MqttJsonNumber number = makeNumber(MqttJsonNumber::FLOAT);
+    number.real = val;
+    // same text as json::dump(), which the DOM lookup used
+    return scalar(false, [val](std::string& out, bool) { mqttJsonAppendFloat(out, val); }, &number);
+  }
+  bool string(json::string_t& val) { return text(val); }
+  bool text(std::string_view val) {
+    return scalar(false, [val](std::string& out, bool quoted) {
+      if (quoted) mqttJsonAppendString(out, val);
+      else out += val;
+      });
+  }
+  bool binary(json::binary_t& val) {
+    return scalar(false, [&val](std::string& out, bool) { out += json::binary(val).dump(); });
+  }
+  bool start_object(std::size_t) { return open(false); }
+  bool end_object() { return close('}'); }
+  bool start_array(std::size_t) { return open(true); }
+  bool end_array() { return close(']'); }
+
+  bool key(json::string_t& val) { return key(std::string_view(val)); }
+  bool key(std::string_view val) {
+    Level& level = ex.levels_[ex.depth_ - 1];
+    for (size_t slot : ex.captures_) {
+      std::string& out = ex.paths_[slot].value;
+      if (level.hasItems) out += ',';
+      mqttJsonAppendString(out, val);
+      out += ':';
+    }
+    level.hasItems = true;
+    level.key.assign(val);
+    return true;
+  }
+
+  bool parse_error(std::size_t, const std::string&, const json::exception& e) {
+    throw std::invalid_argument(e.what());
+  }
+
+#ifdef MQTT_WITH_SIMDJSON
+  /* Feeds an on-demand value and its children to the handler. Returns false once all paths were found. */
+  bool walk(simdjson::ondemand::value value) {
+    namespace od = simdjson::ondemand;
+    od::json_type type{};
+    check(value.type().get(type));
+    switch (type) {
+      case od::json_type::object:
+      {
+        od::object object;
+        check(value.get_object().get(object));
+        if (!open(false)) return false;
+        for (auto field : object) {
+          std::string_view name;
+          od::value child;
+          check(field.unescaped_key().get(name));
+          key(name);
+          check(field.value().get(child));
+          if (!wanted(child)) continue; // not consumed: the iterator skips it without decoding
+          if (!walk(child)) return false;
+        }
+        return close('}');
+      }
+      case od::json_type::array:
+      {
+        od::array array;
+        check(value.get_array().get(array));
+        if (!open(true)) return false;
+        for (auto element : array) {
+          od::value child;
+          check(element.get(child));
+          if (!wanted(child)) {
+            separator(); // still counts as an element
+            continue;
+          }
+          if (!walk(child)) return false;
+        }
+        return close(']');
+      }
+      case od::json_type::number:
+      {
+        od::number_type numberType{};
+        check(value.get_number_type().get(numberType));
+        switch (numberType) {
+          case od::number_type::signed_integer:
+          {
+            int64_t number = 0;
+            check(value.get_int64().get(number));
+            return number_integer(number);
+          }
+          case od::number_type::unsigned_integer:
+          {
+            uint64_t number = 0;
+            check(value.get_uint64().get(number));
+            return number_unsigned(number);
+          }
+          case od::number_type::floating_point_number:
+          {
+            double number = 0;
+            check(value.get_double().get(number));
+            return number_float(number, json::string_t());
+          }
+          default: // integers beyond 64 bits, nlohmann reads them as floats
+            return number_float(strtod(std::string(value.raw_json_token()).c_str(), nullptr), json::string_t());
+        }
+      }
+      case od::json_type::string:
+      {
+        std::string_view str;
+        check(value.get_string().get(str));
+        return text(str);
+      }
+      case od::json_type::boolean:
+      {
+        bool flag = false;
+        check(value.get_bool().get(flag));
+        return boolean(flag);
+      }
+      default:
+      {
+        bool isNull = false;
+        check(value.is_null().get(isNull));
+        if (!isNull) check(simdjson::INCORRECT_TYPE);
+        return null();
+      }
+    }
+  }
+
+  /* true if a path can use the value at the next position: only containers can lead to an unanchored path */
+  bool wanted(simdjson::ondemand::value& value) {
+    namespace od = simdjson::ondemand;
+    od::json_type type{};
+    check(value.type().get(type));
+    return wanted(type == od::json_type::object || type == od::json_type::array);
+  }
+
+  static void check(simdjson::error_code error) {
+    if (error) throw std::invalid_argument(std::string("JSON parse error: ") + simdjson::error_message(error));
+  }
+#endif
+
+private:
+  MqttJsonExtractor& ex;
+
+  /* true if the first count steps of path end at the current position */
+  bool matches(const Path& path, size_t count) const {
+    if (count > ex.depth_ || (path.path.anchored && count != ex.depth_)) return false;
+    for (size_t i = 0; i < count; i++) {
+      const Level& level = ex.levels_[ex.depth_ - 1 - i];
+      const MqttJsonPath::Step& step = path.path.steps[count - 1 - i];
+      if (step.kind == MqttJsonPath::Step::KEY ? level.isArray || level.key != step.key
+        : !level.isArray || level.index != step.begin)
+        return false;
+    }
+    return true;
+  }
+  bool matches(const Path& path) const { return matches(path, path.matchSteps); }
+
+  /* true if the value about to be read (after its key, or as the next array element) is part of a
+     capture or slice, or can be or contain the value of a path. Lets the simdjson walk skip the rest. */
+  bool wanted(bool container) {
+    if (!ex.captures_.empty() || ex.depth_ == 0) return true;
+    Level& level = ex.levels_[ex.depth_ - 1];
+    size_t index = level.index;
+    if (level.isArray && level.hasItems) level.index++; // where separator() will put the element
+    bool result = false;
+    for (const Path& path : ex.paths_) {
+      if (path.found) continue;
+      if (path.sliceDepth) result = path.sliceDepth == ex.depth_;
+      else if (matches(path)) result = true;
+      else if (container) result = !path.path.anchored || (ex.depth_ < path.matchSteps && matches(path, ex.depth_));
+      if (result) break;
+    }
+    level.index = index;
+    return result;
+  }
+
+  /* Array item separator for the values being captured */
+  void separator() {
+    if (ex.depth_ == 0) return;
+    Level& level = ex.levels_[ex.depth_ - 1];
+    if (!level.isArray) return; // objects get theirs with the key
+    if (level.hasItems) {
+      for (size_t slot : ex.captures_) ex.paths_[slot].value += ',';
+      level.index++;
+    }
+    level.hasItems = true;
+  }
+
+  void resolve(Path& path) {
+    path.found = true;
+    path.sliceDepth = 0;
+    ex.remaining_--;
+  }
+
+  /* Value at the current position of the array sliced by path; number is null for other values */
+  void sliceElement(Path& path, const MqttJsonNumber* number) {
+    const Level& level = ex.levels_[ex.depth_ - 1];
+    if (level.index < path.begin) return;
+    path.invalid = number ? path.append(path, *number) : "Non-numeric array element";
+    if (path.invalid || level.index + 1 >= path.end) resolve(path); // the rest of the array is not needed
+  }
+
+  bool more() {
+    if (ex.remaining_ > 0) return true;
+    ex.stoppedEarly_ = true;
+    return false;
+  }
+
+  template <typename Write>
+  bool scalar(bool isNull, Write&& write, const MqttJsonNumber* number = nullptr) {
+    separator();
+    for (size_t slot : ex.captures_) write(ex.paths_[slot].value, true);
+    for (Path& path : ex.paths_) {
+      if (path.found || path.captureDepth) continue;
+      if (path.sliceDepth) {
+        if (path.sliceDepth == ex.depth_) sliceElement(path, number);
+        continue;
+      }
+      if (!matches(path)) continue;
+      if (path.path.isSlice()) path.invalid = "Slice of a non-array value";
+      else if (number) {
+        path.isNumber = true;
+        path.number = *number;
+        path.pendingText = true;
+      }
+      else {
+        path.isNull = isNull;
+        path.value.clear();
+        if (!isNull) write(path.value, false);
+      }
+      resolve(path);
+    }
+    return more();
+  }
+
+  bool open(bool isArray) {
+    separator();
+    char bracket = isArray ? '[' : '{';
+    for (size_t slot : ex.captures_) ex.paths_[slot].value += bracket;
+    for (size_t slot = 0; slot < ex.paths_.size(); slot++) {
+      Path& path = ex.paths_[slot];
+      if (path.found || path.captureDepth) continue;
+      if (path.sliceDepth) {
+        if (path.sliceDepth == ex.depth_) sliceElement(path, nullptr);
+        continue;
+      }
+      if (!matches(path)) continue;
+      if (isArray && (path.asArray || path.path.isSlice())) {
+        path.sliceDepth = ex.depth_ + 1;
+        path.hasElements = true;
+      }
+      else if (path.path.isSlice()) {
+        path.invalid = "Slice of a non-array value";
+        resolve(path);
+      }
+      else {
+        path.value.assign(1, bracket);
+        path.captureDepth = ex.depth_ + 1;
+        ex.captures_.push_back(slot);
+      }
+    }
+    if (ex.levels_.size() == ex.depth_) ex.levels_.emplace_back();
+    Level& level = ex.levels_[ex.depth_++];
+    level.isArray = isArray;
+    level.hasItems = false;
+    level.index = 0;
+    level.key.clear();
+    return more(); // a slice may have ended at this element
+  }
+
+  bool close(char bracket) {
+    for (size_t i = ex.captures_.size(); i-- > 0;) {
+      Path& path = ex.paths_[ex.captures_[i]];
+      path.value += bracket;
+      if (path.captureDepth != ex.depth_) continue;
+      path.captureDepth = 0;
+      resolve(path);
+      ex.captures_.erase(ex.captures_.begin() + i);
+    }
+    for (Path& path : ex.paths_) {
+      if (path.sliceDepth == ex.depth_) resolve(path);
+    }
+    ex.depth_--;
+    return more();
+  }
+};
+
+//#############################################################################################
+
+#ifdef MQTT_WITH_SIMDJSON
+struct MqttJsonExtractor::Simdjson {
+  simdjson::ondemand::parser parser;
+  std::string padded; // payload copy with the trailing padding simdjson reads ahead into
+};
+#else
+struct MqttJsonExtractor::Simdjson {};
+#endif
+
+static MqttJsonExtractor::Backend defaultBackend(json::input_format_t format) {
+  return format == json::input_format_t::json && MqttJsonExtractor::backendAvailable(MqttJsonExtractor::BACKEND_SIMDJSON)
+    ? MqttJsonExtractor::BACKEND_SIMDJSON : MqttJsonExtractor::BACKEND_NLOHMANN;
+}
+
+MqttJsonExtractor::MqttJsonExtractor(json::input_format_t format)
+  : MqttJsonExtractor(format, defaultBackend(format)) {
+}
+
+MqttJsonExtractor::MqttJsonExtractor(json::input_format_t format, Backend backend)
+  : format_(format), backend_(backend) {
+  if (!backendAvailable(backend))
+    throw std::invalid_argument(std::string("JSON backend not available: ") + backendName(backend));
+  if (backend == BACKEND_SIMDJSON) {
+    if (format != json::input_format_t::json) throw std::invalid_argument("simdjson only reads JSON documents");
+    simdjson_.reset(new Simdjson());
+  }
+}
+
+MqttJsonExtractor::MqttJsonExtractor(MqttJsonExtractor&&) = default;
+MqttJsonExtractor& MqttJsonExtractor::operator=(MqttJsonExtractor&&) = default;
+MqttJsonExtractor::~MqttJsonExtractor() = default;
+
+bool MqttJsonExtractor::backendAvailable(Backend backend) {
+#ifdef MQTT_WITH_SIMDJSON
+  return backend == BACKEND_NLOHMANN || backend == BACKEND_SIMDJSON;
+#else
+  return backend == BACKEND_NLOHMANN;
+#endif
+}
+
+const char* MqttJsonExtractor::backendName(Backend backend) {
+  switch (backend) {
+    case BACKEND_NLOHMANN: return "nlohmann";
+    case BACKEND_SIMDJSON: return "simdjson";
+  }
+  return "unknown";
+}
+
+/* Converts number into the element type of path and appends it to its elements */
+template <typename epicsDataType>
+const char* MqttJsonExtractor::appendElement(Path& path, const MqttJsonNumber& number) {
+  epicsDataType value{};
+  const char* error = mqttJsonNumberAs(number, value);
+  if (error) return error;
+  size_t slots = ((path.elementCount + 1) * sizeof(epicsDataType) + sizeof(epicsInt64) - 1) / sizeof(epicsInt64);
+  if (slots > path.elements.size()) path.elements.resize(std::max(slots, path.elements.size() * 2)); // kept across messages
+  reinterpret_cast<epicsDataType*>(path.elements.data())[path.elementCount++] = value;
+  return nullptr;
+}
+
+size_t MqttJsonExtractor::addPath(const std::string& field, bool asArray, ElementType elementType) {
+  for (size_t slot = 0; slot < paths_.size(); slot++) {
+    const Path& path = paths_[slot];
+    if (path.field == field && path.asArray == asArray && path.elementType == elementType) return slot;
+  }
+  Path path;
+  path.path = MqttJsonPath::parse(field);
+  path.field = field;
+  path.asArray = asArray;
+  path.elementType = elementType;
+  switch (elementType) {
+    case ELEMENT_INT8: path.append = &appendElement<epicsInt8>; break;
+    case ELEMENT_INT16: path.append = &appendElement<epicsInt16>; break;
+    case ELEMENT_INT32: path.append = &appendElement<epicsInt32>; break;
+    case ELEMENT_INT64: path.append = &appendElement<epicsInt64>; break;
+    case ELEMENT_FLOAT32: path.append = &appendElement<epicsFloat32>; break;
+    case ELEMENT_FLOAT64: path.append = &appendElement<epicsFloat64>; break;
+  }
+  path.matchSteps = path.path.steps.size();
+  path.end = SIZE_MAX;
+  if (path.path.isSlice()) {
+    path.matchSteps--;
+    path.begin = path.path.steps.back().begin;
+    path.end = path.path.steps.back().end;
+  }
+  paths_.push_back(std::move(path));
+  return paths_.size() - 1;
+}
+
+void MqttJsonExtractor::reset() {
+  for (Path& path : paths_) {
+    path.found = false;
+    path.isNull = false;
+    path.isNumber = false;
+    path.pendingText = false;
+    path.hasElements = false;
+    path.invalid = nullptr;
+    path.captureDepth = 0;
+    path.sliceDepth = 0;
+    path.elementCount = 0;
+  }
+  captures_.clear();
+  depth_ = 0;
+  remaining_ = paths_.size();
+  stoppedEarly_ = false;
+}
+
+void MqttJsonExtractor::extract(const std::string& payload) {
+  reset();
+  if (paths_.empty()) return;
+#ifdef MQTT_WITH_SIMDJSON
+  if (backend_ == BACKEND_SIMDJSON) {
+    try {
+      if (extractSimdjson(payload)) return;
+    }
+    catch (const std::invalid_argument&) {
+      // simdjson checks the structure of the whole document up front, while reading stops at the last
+      // path: nlohmann decides on malformed documents, so both backends accept the same ones
+    }
+    reset();
+  }
+#endif
+  Sax sax(*this);
+  json::sax_parse(payload, &sax, format_);
+}
+
+#ifdef MQTT_WITH_SIMDJSON
+/* Extracts the paths of an object or array document with simdjson; false for other documents */
+bool MqttJsonExtractor::extractSimdjson(const std::string& payload) {
+  Sax sax(*this);
+  // simdjson reads past the end of the document; payloads with enough spare capacity are used in place
+  const std::string* input = &payload;
+  if (payload.capacity() - payload.size() < simdjson::SIMDJSON_PADDING) {
+    std::string& padded = simdjson_->padded;
+    padded.reserve(payload.size() + simdjson::SIMDJSON_PADDING); // grows to the largest payload, then reused
+    padded.assign(payload);
+    input = &padded;
+  }
+  simdjson::ondemand::document doc;
+  Sax::check(simdjson_->parser.iterate(input->data(), input->size(), input->capacity()).get(doc));
+  simdjson::ondemand::json_type type{};
+  Sax::check(doc.type().get(type));
+  // scalar documents are left to nlohmann, which also reports slices of them
+  if (type != simdjson::ondemand::json_type::object && type != simdjson::ondemand::json_type::array) return false;
+  simdjson::ondemand::value root;
+  Sax::check(doc.get_value().get(root));
+  if (sax.walk(root) && !doc.at_end()) throw std::invalid_argument("JSON parse error: trailing content");
+  return true;
+}
+#endif
+
+const std::string* MqttJsonExtractor::value(size_t slot) const {
+  const Path& path = paths_[slot];
+  if (!path.found || path.isNull || path.hasElements || path.invalid) return nullptr;
+  if (path.pendingText) {
+    path.value.clear();
+    switch (path.number.kind) {
+      case MqttJsonNumber::INTEGER: mqttJsonAppendInteger(path.value, path.number.integer); break;
+      case MqttJsonNumber::UNSIGNED: mqttJsonAppendUnsigned(path.value, path.number.uinteger); break;
+      case MqttJsonNumber::FLOAT: mqttJsonAppendFloat(path.value, path.number.real); break;
+    }
+    path.pendingText = false;
+  }
+  return &path.value;
+}
+
+const MqttJsonNumber* MqttJsonExtractor::number(size_t slot) const {
+  const Path& path = paths_[slot];
+  return path.found && path.isNumber ? &path.number : nullptr;
+}
+
+bool MqttJsonExtractor::elements(size_t slot, const void*& data, size_t& count) const {
+  const Path& path = paths_[slot];
+  if (!path.found) return false;
+  if (path.invalid) throw std::invalid_argument(path.invalid);
+  if (!path.hasElements) return false;
+  if (path.elementCount == 0) throw std::invalid_argument("Empty array");
+  data = path.elements.data();
+  count = path.elementCount;
+  return true;
+}
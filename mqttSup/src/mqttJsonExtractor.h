@@ -0,0 +1,199 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2026 André Favoto
+
+#ifndef MQTTJSONEXTRACTOR_H
+#define MQTTJSONEXTRACTOR_H
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include <epicsTypes.h>
+#include "json/json.hpp"
+
+/*! \brief Compiled field path.
+ *
+ *   path  := ["$" ["."]] step ("." step)*
+ *   step  := key ("[" index "]")* | ("[" index "]")+
+ *   last  := ... "[" [begin] ":" [end] "]"    (slice, end excluded)
+ *
+ * e.g. "sensor.temperature", "channels[17].value", "data[0:1024]". Keys match
+ * directly nested object keys and indices the elements of arrays. Without
+ * the "$" anchor the steps may start at any depth of the document (a single
+ * key matches that key anywhere); with it they start at the root. A slice
+ * selects a range of elements of the array it follows and must come last.
+ */
+struct MqttJsonPath {
+  struct Step {
+    enum Kind { KEY, INDEX, SLICE };
+    Kind kind = KEY;
+    std::string key;  // KEY
+    size_t begin = 0; // INDEX, SLICE
+    size_t end = 0;   // SLICE, SIZE_MAX if open
+  };
+  std::vector<Step> steps;
+  bool anchored = false;
+
+  bool isSlice() const { return !steps.empty() && steps.back().kind == Step::SLICE; }
+  /* true if the path is only keys, the documents JSON output records can write */
+  bool keysOnly() const;
+  /* Throws std::invalid_argument on malformed paths */
+  static MqttJsonPath parse(const std::string& field);
+};
+
+/* Number read from a document, in the type it has there */
+struct MqttJsonNumber {
+  enum Kind { INTEGER, UNSIGNED, FLOAT };
+  Kind kind;
+  epicsInt64 integer = 0;
+  epicsUInt64 uinteger = 0;
+  double real = 0;
+};
+
+/* Converts a document number into a record value: integers must fit, floats are only read into float
+   types and must be in their range. Returns why number cannot be converted, nullptr if it was. */
+template <typename epicsDataType>
+const char* mqttJsonNumberAs(const MqttJsonNumber& number, epicsDataType& value) {
+  typedef std::numeric_limits<epicsDataType> limits;
+  if constexpr (std::is_floating_point<epicsDataType>::value) {
+    switch (number.kind) {
+      case MqttJsonNumber::INTEGER: value = static_cast<epicsDataType>(number.integer); return nullptr;
+      case MqttJsonNumber::UNSIGNED: value = static_cast<epicsDataType>(number.uinteger); return nullptr;
+      case MqttJsonNumber::FLOAT: break;
+    }
+    if (std::isfinite(number.real) && std::fabs(number.real) > limits::max()) return "Float out of range";
+    value = static_cast<epicsDataType>(number.real);
+  }
+  else {
+    switch (number.kind) {
+      case MqttJsonNumber::INTEGER:
+        if (number.integer < static_cast<epicsInt64>(limits::min()) || number.integer > static_cast<epicsInt64>(limits::max()))
+          return "Integer out of range";
+        value = static_cast<epicsDataType>(number.integer);
+        break;
+      case MqttJsonNumber::UNSIGNED:
+        if (number.uinteger > static_cast<epicsUInt64>(limits::max())) return "Integer out of range";
+        value = static_cast<epicsDataType>(number.uinteger);
+        break;
+      case MqttJsonNumber::FLOAT:
+        return "Invalid integer";
+    }
+  }
+  return nullptr;
+}
+
+/*! \brief Single-pass field extraction from JSON, CBOR and MessagePack documents.
+ *
+ * Holds the compiled field paths of all records reading one topic and
+ * streams each payload through nlohmann's SAX interface instead of building
+ * a DOM: only the referenced values are converted (containers are
+ * re-serialized as compact JSON, strings are returned unquoted), everything
+ * else is skipped, and parsing stops as soon as every path was found. The
+ * state is reused across messages, so a topic stops allocating once its
+ * largest values fit.
+ *
+ * Paths are described in MqttJsonPath; the first match in document order
+ * wins. Numbers are not converted to text unless value() asks for it: they
+ * are kept as MqttJsonNumber. The elements of slices and of the arrays
+ * matched by paths added with asArray are converted into the element type of
+ * their path as they are read, into a buffer a record can post directly.
+ *
+ * JSON documents are read with simdjson's on-demand API when the library is
+ * built in (WITH_SIMDJSON in configure/CONFIG_SITE), which gives the same
+ * values and skips fields no path can reach without decoding them; CBOR
+ * and MessagePack always use nlohmann.
+ */
+class MqttJsonExtractor {
+public:
+  enum Backend { BACKEND_NLOHMANN, BACKEND_SIMDJSON };
+  /* Type the elements of slices and asArray paths are converted into */
+  enum ElementType { ELEMENT_INT8, ELEMENT_INT16, ELEMENT_INT32, ELEMENT_INT64, ELEMENT_FLOAT32, ELEMENT_FLOAT64 };
+
+  /* Uses the fastest backend built in for format */
+  explicit MqttJsonExtractor(nlohmann::json::input_format_t format = nlohmann::json::input_format_t::json);
+  /* Throws std::invalid_argument if backend is not built in or cannot read format */
+  MqttJsonExtractor(nlohmann::json::input_format_t format, Backend backend);
+  MqttJsonExtractor(MqttJsonExtractor&&);
+  MqttJsonExtractor& operator=(MqttJsonExtractor&&);
+  ~MqttJsonExtractor();
+
+  static bool backendAvailable(Backend backend);
+  static const char* backendName(Backend backend);
+  Backend backend() const { return backend_; }
+
+  /* Compiles a field path, returns its slot. Paths already added with the same options return
+     their existing slot. With asArray, an array matched by the path is read like a slice of all its
+     elements. Throws std::invalid_argument on malformed paths. */
+  size_t addPath(const std::string& field, bool asArray = false, ElementType elementType = ELEMENT_FLOAT64);
+  size_t pathCount() const { return paths_.size(); }
+
+  /* Extracts all paths from payload. Throws std::invalid_argument if the
+     document is malformed before the last path was found. simdjson does not
+     check the syntax inside the values it skips, so it may accept a document
+     malformed only there; otherwise both backends accept the same documents
+     and read the same values. */
+  void extract(const std::string& payload);
+  /* Value of a slot after extract() as text (numbers are formatted on the first call); nullptr if
+     the field was missing or null, or was read as elements */
+  const std::string* value(size_t slot) const;
+  /* Value of a slot after extract(); nullptr if the field was missing or not a number */
+  const MqttJsonNumber* number(size_t slot) const;
+  /* Elements of a slice or asArray path after extract(): true with data pointing to count values of
+     the element type of the path, valid until the next extract(); false if the field was missing or,
+     for asArray, not an array. Throws std::invalid_argument if a slice was not taken from an array,
+     an element is not a number or does not fit the element type, or there are no elements (an empty
+     array or a slice past its end, rejected like empty FLAT arrays). */
+  bool elements(size_t slot, const void*& data, size_t& count) const;
+  bool isSlice(size_t slot) const { return paths_[slot].path.isSlice(); }
+  /* true if the last extract() found every path and stopped reading the payload there */
+  bool stoppedEarly() const { return stoppedEarly_; }
+
+private:
+  struct Path {
+    MqttJsonPath path;
+    std::string field;
+    bool asArray = false;
+    ElementType elementType = ELEMENT_FLOAT64;
+    const char* (*append)(Path& path, const MqttJsonNumber& number) = nullptr; // appendElement of elementType
+    size_t matchSteps = 0;          // steps matched by the value; slices match the array they select from
+    size_t begin = 0, end = 0;      // range of elements read by slices and asArray paths
+    mutable std::string value;
+    MqttJsonNumber number;
+    std::vector<epicsInt64> elements; // 8-byte slots keep the converted elements aligned for every type
+    size_t elementCount = 0;
+    bool found = false;
+    bool isNull = false;
+    bool isNumber = false;
+    mutable bool pendingText = false; // number not formatted into value yet
+    bool hasElements = false;
+    const char* invalid = nullptr; // why a slice or asArray path has no elements
+    size_t captureDepth = 0; // container depth of a value being captured, 0 if none
+    size_t sliceDepth = 0;   // container depth of the array being sliced, 0 if none
+  };
+  struct Level {
+    bool isArray = false;
+    bool hasItems = false;
+    size_t index = 0; // current element, arrays only
+    std::string key;  // last key read, objects only
+  };
+  class Sax;
+  void reset();
+  bool extractSimdjson(const std::string& payload); // BACKEND_SIMDJSON only
+  template <typename epicsDataType>
+  static const char* appendElement(Path& path, const MqttJsonNumber& number);
+  struct Simdjson; // parser and padded copy of the payload, only used by BACKEND_SIMDJSON
+
+  nlohmann::json::input_format_t format_;
+  Backend backend_;
+  std::unique_ptr<Simdjson> simdjson_;
+  std::vector<Path> paths_;
+  std::vector<Level> levels_; // open containers, only the first depth_ are in use
+  size_t depth_ = 0;
+  size_t remaining_ = 0;      // paths not found yet
+  std::vector<size_t> captures_; // slots of containers being captured
+  bool stoppedEarly_ = false;
+};
+
+#endif
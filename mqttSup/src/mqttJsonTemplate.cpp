@@ -0,0 +1,117 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2026 André Favoto
+
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+#include "json/json.hpp"
+#include "mqttJsonTemplate.h"
+
+/* Bytes of the UTF-8 sequence starting at s[i] (RFC 3629: no overlong forms, surrogates or code
+   points beyond U+10FFFF). An invalid sequence has valid false and the length of its longest valid
+   prefix, at least 1, which json::dump() replaces as a whole. */
+static size_t utf8Sequence(std::string_view s, size_t i, bool& valid) {
+  unsigned char lead = static_cast<unsigned char>(s[i]);
+  size_t length;
+  unsigned char low = 0x80, high = 0xBF; // range of the first continuation byte
+  valid = false;
+  if (lead >= 0xC2 && lead <= 0xDF) length = 2;
+  else if (lead >= 0xE0 && lead <= 0xEF) {
+    length = 3;
+    if (lead == 0xE0) low = 0xA0;
+    else if (lead == 0xED) high = 0x9F;
+  }
+  else if (lead >= 0xF0 && lead <= 0xF4) {
+    length = 4;
+    if (lead == 0xF0) low = 0x90;
+    else if (lead == 0xF4) high = 0x8F;
+  }
+  else return 1;
+  if (i + 1 >= s.size() || static_cast<unsigned char>(s[i + 1]) < low || static_cast<unsigned char>(s[i + 1]) > high)
+    return 1;
+  for (size_t k = 2; k < length; k++) {
+    if (i + k >= s.size() || (static_cast<unsigned char>(s[i + k]) & 0xC0) != 0x80) return k;
+  }
+  valid = true;
+  return length;
+}
+
+void mqttJsonAppendString(std::string& out, std::string_view s) {
+  out += '"';
+  for (size_t i = 0; i < s.size(); i++) {
+    char c = s[i];
+    if (static_cast<unsigned char>(c) >= 0x80) {
+      // bytes that are not UTF-8 would make the document invalid JSON
+      bool valid;
+      size_t length = utf8Sequence(s, i, valid);
+      if (valid) out.append(s, i, length);
+      else out += "\xEF\xBF\xBD"; // U+FFFD
+      i += length - 1;
+      continue;
+    }
+    switch (c) {
+      case '"': out += "\\\""; break;
+      case '\\': out += "\\\\"; break;
+      case '\b': out += "\\b"; break;
+      case '\f': out += "\\f"; break;
+      case '\n': out += "\\n"; break;
+      case '\r': out += "\\r"; break;
+      case '\t': out += "\\t"; break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          char escaped[8];
+          snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned char>(c));
+          out += escaped;
+        }
+        else out += c;
+    }
+  }
+  out += '"';
+}
+
+void mqttJsonAppendInteger(std::string& out, epicsInt64 value) {
+  char buffer[24];
+  out.append(buffer, std::to_chars(buffer, buffer + sizeof(buffer), value).ptr);
+}
+
+void mqttJsonAppendUnsigned(std::string& out, epicsUInt64 value) {
+  char buffer[24];
+  out.append(buffer, std::to_chars(buffer, buffer + sizeof(buffer), value).ptr);
+}
+
+/* nlohmann's shortest round-trip formatting, the one json::dump() uses */
+template <typename FloatType>
+static void appendFloat(std::string& out, FloatType value) {
+  if (!std::isfinite(value)) {
+    out += "null";
+    return;
+  }
+  char buffer[64];
+  out.append(buffer, nlohmann::detail::to_chars(buffer, buffer + sizeof(buffer), value));
+}
+
+void mqttJsonAppendFloat(std::string& out, double value) {
+  appendFloat(out, value);
+}
+
+void mqttJsonAppendFloat(std::string& out, float value) {
+  appendFloat(out, value);
+}
+
+//#############################################################################################
+
+MqttJsonTemplate::MqttJsonTemplate(const MqttJsonPath& path) {
+  if (!path.keysOnly()) return; // empty(): indexed documents cannot be written
+  prefix_ = "{";
+  for (size_t i = 0; i < path.steps.size(); i++) {
+    if (i > 0) prefix_ += '{';
+    mqttJsonAppendString(prefix_, path.steps[i].key);
+    prefix_ += ':';
+    suffix_ += '}';
+  }
+}
+
+void MqttJsonTemplate::requirePath() const {
+  if (prefix_.empty()) throw std::logic_error("JSON writes need a field path of keys only");
+}
@@ -0,0 +1,79 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2026 André Favoto
+
+#ifndef MQTTJSONTEMPLATE_H
+#define MQTTJSONTEMPLATE_H
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <epicsTypes.h>
+#include "mqttJsonExtractor.h"
+
+/* JSON text of values, as written by json::dump() (non-finite floats as null); bytes of strings
+   that are not valid UTF-8 are replaced by U+FFFD, like json::dump() with error_handler_t::replace */
+void mqttJsonAppendString(std::string& out, std::string_view s);
+void mqttJsonAppendInteger(std::string& out, epicsInt64 value);
+void mqttJsonAppendUnsigned(std::string& out, epicsUInt64 value);
+void mqttJsonAppendFloat(std::string& out, double value);
+void mqttJsonAppendFloat(std::string& out, float value); // shortest text of the float, not of its double
+
+template <typename T>
+void mqttJsonAppendNumber(std::string& out, T value) {
+  if constexpr (std::is_floating_point<T>::value) mqttJsonAppendFloat(out, value);
+  else if constexpr (std::is_signed<T>::value) mqttJsonAppendInteger(out, value);
+  else mqttJsonAppendUnsigned(out, value);
+}
+
+/*! \brief Payload template of JSON output records.
+ *
+ * Compiled once from the record's field path: "sensor.setpoint" gives the
+ * document {"sensor":{"setpoint":<value>}}, kept as its static prefix and
+ * suffix. Paths with indices or slices give an empty template, which
+ * refuses to render. Rendering a value is a number format between two copies into a
+ * buffer reused across writes, with no document tree involved.
+ */
+class MqttJsonTemplate {
+public:
+  MqttJsonTemplate() = default;
+  explicit MqttJsonTemplate(const MqttJsonPath& path);
+
+  bool empty() const { return prefix_.empty(); }
+  const std::string& prefix() const { return prefix_; }
+  const std::string& suffix() const { return suffix_; }
+
+  /* Replace out with the document holding value */
+  template <typename T>
+  void render(T value, std::string& out) const {
+    requirePath();
+    out.assign(prefix_);
+    mqttJsonAppendNumber(out, value);
+    out.append(suffix_);
+  }
+  void renderString(std::string_view value, std::string& out) const {
+    requirePath();
+    out.assign(prefix_);
+    mqttJsonAppendString(out, value);
+    out.append(suffix_);
+  }
+  template <typename T>
+  void renderArray(const T* data, size_t count, std::string& out) const {
+    requirePath();
+    out.assign(prefix_);
+    out += '[';
+    for (size_t i = 0; i < count; i++) {
+      if (i > 0) out += ',';
+      mqttJsonAppendNumber(out, data[i]);
+    }
+    out += ']';
+    out.append(suffix_);
+  }
+
+private:
+  /* Throws std::logic_error if empty() */
+  void requirePath() const;
+
+  std::string prefix_;
+  std::string suffix_;
+};
+
+#endif
@@ -0,0 +1,108 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2026 André Favoto
+
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include "mqttLoopback.h"
+
+const char* LoopbackTransport::URL_SCHEME = "loopback://";
+
+LoopbackTransport::LoopbackTransport(const Config& cfg)
+  : config_(cfg) {
+}
+
+void LoopbackTransport::connect() {
+  connected_ = true;
+  if (connectionCb_) connectionCb_("loopback connect");
+}
+
+void LoopbackTransport::disconnect() {
+  connected_ = false;
+}
+
+void LoopbackTransport::reconnect() {
+  if (!connected_) connect();
+}
+
+void LoopbackTransport::subscribe(const std::string& topic) {
+  if (!connected_)
+    throw std::runtime_error("MQTT client not connected");
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    subscriptions_.insert(topic);
+  }
+  if (subscriptionCb_) subscriptionCb_(topic);
+}
+
+void LoopbackTransport::unsubscribe(const std::string& topic) {
+  if (!connected_)
+    throw std::runtime_error("MQTT client not connected");
+  std::lock_guard<std::mutex> guard(mutex_);
+  subscriptions_.erase(topic);
+}
+
+void LoopbackTransport::publish(const std::string& topic, const std::string& payload, int qos, bool retained) {
+  if (!connected_)
+    throw std::runtime_error("MQTT client not connected");
+  if (publishCb_) publishCb_(topic);
+  inject(topic, payload);
+}
+
+/* MQTT topic filter matching: '+' matches one level, a trailing '#' all remaining levels */
+static bool topicMatches(const std::string& filter, const std::string& topic) {
+  size_t f = 0, t = 0;
+  while (f < filter.size()) {
+    if (filter[f] == '#') return true;
+    if (t == topic.size() && filter.compare(f, std::string::npos, "/#") == 0) return true; // "a/#" matches "a"
+    if (filter[f] == '+') {
+      while (t < topic.size() && topic[t] != '/') t++;
+      f++;
+    }
+    else {
+      if (t >= topic.size() || filter[f] != topic[t]) return false;
+      f++;
+      t++;
+    }
+  }
+  return t == topic.size();
+}
+
+bool LoopbackTransport::isSubscribed(const std::string& topic) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  if (subscriptions_.count(topic)) return true;
+  for (const auto& filter : subscriptions_) {
+    if (filter.find_first_of("+#") != std::string::npos && topicMatches(filter, topic)) return true;
+  }
+  return false;
+}
+
+bool LoopbackTransport::inject(const std::string& topic, const std::string& payload) {
+  if (!messageCb_ || !isSubscribed(topic)) return false;
+  capture(topic, payload, config_.qos, false);
+  messageCb_(topic, payload);
+  return true;
+}
+
+void LoopbackTransport::injectAtRate(const std::vector<std::string>& topics, const std::vector<std::string>& payloads,
+  size_t count, double rateHz, std::vector<double>* latenciesNs) {
+  using clock = std::chrono::steady_clock;
+  if (topics.empty() || topics.size() != payloads.size())
+    throw std::invalid_argument("topics and payloads must be non-empty and of the same size");
+  if (latenciesNs) latenciesNs->reserve(latenciesNs->size() + count);
+
+  const auto period = rateHz > 0 ? std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1.0 / rateHz))
+    : clock::duration::zero();
+  auto next = clock::now();
+  for (size_t i = 0; i < count; i++) {
+    if (rateHz > 0) {
+      std::this_thread::sleep_until(next);
+      next += period;
+    }
+    size_t n = i % topics.size();
+    auto start = clock::now();
+    inject(topics[n], payloads[n]);
+    if (latenciesNs)
+      latenciesNs->push_back(std::chrono::duration<double, std::nano>(clock::now() - start).count());
+  }
+}
@@ -0,0 +1,54 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2026 André Favoto
+
+#ifndef MQTTLOOPBACK_H
+#define MQTTLOOPBACK_H
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "mqttTransport.h"
+
+/*! \brief In-process MQTT transport with no broker behind it.
+ *
+ * Selected with a "loopback://" broker URL. Connecting and subscribing
+ * succeed immediately, and publishing to a subscribed topic delivers the
+ * message back to the message callback on the publisher's thread, like a
+ * broker would. inject() and injectAtRate() feed messages as if they came
+ * from a remote publisher, which lets benchmarks measure the driver's own
+ * decode/dispatch cost in isolation.
+ */
+class LoopbackTransport : public MqttTransport {
+public:
+  static const char* URL_SCHEME;
+
+  LoopbackTransport(const Config& cfg);
+
+  void connect() override;
+  void disconnect() override;
+  void reconnect() override;
+  void subscribe(const std::string& topic) override;
+  using MqttTransport::subscribe;
+  void unsubscribe(const std::string& topic) override;
+  void publish(const std::string& topic, const std::string& payload, int qos = -1, bool retained = false) override;
+
+  /* Delivers a message to the message callback if the topic is subscribed.
+     Returns false if nobody is subscribed to it. */
+  bool inject(const std::string& topic, const std::string& payload);
+  /* Injects 'count' messages cycling over 'topics'/'payloads' (matched by
+     index) at 'rateHz' messages per second (0: as fast as possible).
+     If 'latenciesNs' is given, it receives the time spent delivering each
+     message, i.e. the duration of the message callback. */
+  void injectAtRate(const std::vector<std::string>& topics, const std::vector<std::string>& payloads,
+    size_t count, double rateHz, std::vector<double>* latenciesNs = nullptr);
+
+  bool isSubscribed(const std::string& topic);
+
+private:
+  Config config_;
+  std::atomic<bool> connected_{ false }; // set by the IOC thread, read by injecting threads
+  std::mutex mutex_;
+  std::unordered_set<std::string> subscriptions_;
+};
+#endif
@@ -0,0 +1,118 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2026 André Favoto
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "mqttSnapshot.h"
+
+static const char SNAPSHOT_MAGIC[8] = { 'M', 'Q', 'T', 'T', 'S', 'N', 'P', '1' };
+static const size_t FILE_HEADER_SIZE = 12;
+static const size_t ENTRY_HEADER_SIZE = 8;
+
+static void putLE(unsigned char* dst, uint64_t value, size_t bytes) {
+  for (size_t i = 0; i < bytes; i++) dst[i] = static_cast<unsigned char>(value >> (8 * i));
+}
+
+static uint64_t getLE(const unsigned char* src, size_t bytes) {
+  uint64_t value = 0;
+  for (size_t i = 0; i < bytes; i++) value |= static_cast<uint64_t>(src[i]) << (8 * i);
+  return value;
+}
+
+static std::runtime_error ioError(const std::string& what, const std::string& path) {
+  return std::runtime_error(what + " '" + path + "': " + strerror(errno));
+}
+
+void MqttSnapshot::write(const std::string& path, const std::vector<MqttSnapshotEntry>& entries) {
+  size_t size = FILE_HEADER_SIZE;
+  for (const auto& entry : entries)
+    size += ENTRY_HEADER_SIZE + entry.key.size() + entry.value.size();
+
+  /* Built in memory and written with write(): a shared mapping of the file would
+     raise SIGBUS instead of an error when the disk is full */
+  std::vector<unsigned char> buffer(size);
+  unsigned char* p = buffer.data();
+  memcpy(p, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+  putLE(p + 8, entries.size(), 4);
+  p += FILE_HEADER_SIZE;
+  for (const auto& entry : entries) {
+    putLE(p, entry.key.size(), 2);
+    p[2] = entry.type;
+    p[3] = 0;
+    putLE(p + 4, entry.value.size(), 4);
+    p += ENTRY_HEADER_SIZE;
+    memcpy(p, entry.key.data(), entry.key.size());
+    p += entry.key.size();
+    memcpy(p, entry.value.data(), entry.value.size());
+    p += entry.value.size();
+  }
+
+  std::string tmpPath = path + ".tmp";
+  int fd = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) throw ioError("Cannot create snapshot", tmpPath);
+  for (size_t done = 0; done < size; ) {
+    ssize_t n = ::write(fd, buffer.data() + done, size - done);
+    if (n < 0 && errno == EINTR) continue;
+    if (n < 0) {
+      ::close(fd);
+      throw ioError("Cannot write snapshot", tmpPath);
+    }
+    done += n;
+  }
+  if (fsync(fd) != 0) {
+    ::close(fd);
+    throw ioError("Cannot flush snapshot", tmpPath);
+  }
+  if (::close(fd) != 0) throw ioError("Cannot flush snapshot", tmpPath);
+  if (rename(tmpPath.c_str(), path.c_str()) != 0) throw ioError("Cannot replace snapshot", path);
+}
+
+std::vector<MqttSnapshotEntry> MqttSnapshot::read(const std::string& path) {
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0 && errno == ENOENT) return {}; // first start, nothing saved yet
+  if (fd < 0) throw ioError("Cannot open snapshot", path);
+  struct stat st;
+  if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < FILE_HEADER_SIZE) {
+    ::close(fd);
+    throw std::runtime_error("Invalid snapshot file '" + path + "'");
+  }
+  size_t size = st.st_size;
+  void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (map == MAP_FAILED) throw ioError("Cannot map snapshot", path);
+
+  const unsigned char* p = static_cast<const unsigned char*>(map);
+  const unsigned char* end = p + size;
+  std::vector<MqttSnapshotEntry> entries;
+  bool valid = memcmp(p, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) == 0;
+  size_t count = valid ? getLE(p + 8, 4) : 0;
+  p += FILE_HEADER_SIZE;
+  for (size_t i = 0; valid && i < count; i++) {
+    if (static_cast<size_t>(end - p) < ENTRY_HEADER_SIZE) {
+      valid = false;
+      break;
+    }
+    size_t keyLen = getLE(p, 2);
+    uint8_t type = p[2];
+    size_t valueLen = getLE(p + 4, 4);
+    p += ENTRY_HEADER_SIZE;
+    if (static_cast<size_t>(end - p) < keyLen + valueLen) {
+      valid = false;
+      break;
+    }
+    MqttSnapshotEntry entry;
+    entry.key.assign(reinterpret_cast<const char*>(p), keyLen);
+    entry.type = type;
+    entry.value.assign(reinterpret_cast<const char*>(p + keyLen), valueLen);
+    entries.push_back(std::move(entry));
+    p += keyLen + valueLen;
+  }
+  munmap(map, size);
+  if (!valid) throw std::runtime_error("Invalid snapshot file '" + path + "'");
+  return entries;
+}
@@ -0,0 +1,38 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2026 André Favoto
+
+#ifndef MQTTSNAPSHOT_H
+#define MQTTSNAPSHOT_H
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+  Last-value snapshot file.
+
+  File layout (all integers little-endian):
+
+    header:  8 bytes magic "MQTTSNP1", u32 entry count
+    entries: u16 key length, u8 value type, u8 reserved, u32 value length,
+             key bytes, value bytes
+
+  The key identifies the device variable (function, topic and field) and the
+  value holds its last decoded value in native binary form. The file is
+  written to a temporary file that is synced and renamed over the previous
+  snapshot, so readers never see a partially written file.
+*/
+struct MqttSnapshotEntry {
+  std::string key;
+  uint8_t type = 0;
+  std::string value;
+};
+
+class MqttSnapshot {
+public:
+  /* Throws std::runtime_error on I/O errors */
+  static void write(const std::string& path, const std::vector<MqttSnapshotEntry>& entries);
+  /* Returns no entries if the file does not exist. Throws std::runtime_error
+     if the file cannot be mapped or is malformed */
+  static std::vector<MqttSnapshotEntry> read(const std::string& path);
+};
+#endif
@@ -0,0 +1,275 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2026 André Favoto
+
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include "mqttSparkplug.h"
+
+static const std::string_view SPARKPLUG_NAMESPACE = "spBv1.0";
+
+bool MqttSparkplugTopic::parse(std::string_view topic, MqttSparkplugTopic& out) {
+  std::string_view levels[5];
+  size_t count = 0;
+  size_t start = 0;
+  for (;;) {
+    size_t slash = topic.find('/', start);
+    if (count == 5) return false; // too many levels
+    levels[count++] = topic.substr(start, slash == std::string_view::npos ? std::string_view::npos : slash - start);
+    if (slash == std::string_view::npos) break;
+    start = slash + 1;
+  }
+  if (count < 4 || levels[0] != SPARKPLUG_NAMESPACE) return false;
+
+  static const struct { const char* name; MessageType type; } types[] = {
+    { "NBIRTH", NBIRTH }, { "NDEATH", NDEATH }, { "NDATA", NDATA }, { "NCMD", NCMD },
+    { "DBIRTH", DBIRTH }, { "DDEATH", DDEATH }, { "DDATA", DDATA }, { "DCMD", DCMD }
+  };
+  for (const auto& entry : types) {
+    if (levels[2] != entry.name) continue;
+    bool deviceType = entry.name[0] == 'D';
+    if (count != (deviceType ? 5u : 4u)) return false;
+    out.type = entry.type;
+    out.group = levels[1];
+    out.edgeNode = levels[3];
+    out.device = deviceType ? levels[4] : std::string_view();
+    return !out.group.empty() && !out.edgeNode.empty() && (!deviceType || !out.device.empty());
+  }
+  return false;
+}
+
+//#############################################################################################
+// Protobuf wire format
+
+enum WireType { WIRE_VARINT = 0, WIRE_FIXED64 = 1, WIRE_LEN = 2, WIRE_FIXED32 = 5 };
+
+static void truncated() {
+  throw std::invalid_argument("Truncated Sparkplug payload");
+}
+
+static epicsUInt64 readVarint(const char*& p, const char* end) {
+  epicsUInt64 value = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    if (p == end) truncated();
+    epicsUInt8 byte = static_cast<epicsUInt8>(*p++);
+    value |= static_cast<epicsUInt64>(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) return value;
+  }
+  throw std::invalid_argument("Malformed varint in Sparkplug payload");
+}
+
+static epicsUInt64 readFixed(const char*& p, const char* end, size_t size) {
+  if (static_cast<size_t>(end - p) < size) truncated();
+  epicsUInt64 value = 0;
+  for (size_t i = 0; i < size; i++) value |= static_cast<epicsUInt64>(static_cast<epicsUInt8>(p[i])) << (8 * i);
+  p += size;
+  return value;
+}
+
+static std::string_view readBytes(const char*& p, const char* end) {
+  epicsUInt64 size = readVarint(p, end);
+  if (size > static_cast<epicsUInt64>(end - p)) truncated();
+  std::string_view bytes(p, size);
+  p += size;
+  return bytes;
+}
+
+static void skipField(unsigned wireType, const char*& p, const char* end) {
+  switch (wireType) {
+    case WIRE_VARINT: readVarint(p, end); break;
+    case WIRE_FIXED64: readFixed(p, end, 8); break;
+    case WIRE_LEN: readBytes(p, end); break;
+    case WIRE_FIXED32: readFixed(p, end, 4); break;
+    default: throw std::invalid_argument("Unsupported protobuf wire type " + std::to_string(wireType));
+  }
+}
+
+static void expectWireType(unsigned wireType, unsigned expected) {
+  if (wireType != expected) throw std::invalid_argument("Unexpected protobuf wire type in Sparkplug metric");
+}
+
+/* Decodes a Payload.Metric message (see sparkplug_b.proto) */
+static void parseMetric(const char* p, const char* end, MqttSparkplugMetric& metric) {
+  metric = MqttSparkplugMetric();
+  while (p < end) {
+    epicsUInt64 key = readVarint(p, end);
+    unsigned field = static_cast<unsigned>(key >> 3);
+    unsigned wireType = static_cast<unsigned>(key & 7);
+    switch (field) {
+      case 1: // name
+        expectWireType(wireType, WIRE_LEN);
+        metric.name = readBytes(p, end);
+        break;
+      case 2: // alias
+        expectWireType(wireType, WIRE_VARINT);
+        metric.alias = readVarint(p, end);
+        metric.hasAlias = true;
+        break;
+      case 4: // datatype
+        expectWireType(wireType, WIRE_VARINT);
+        metric.datatype = static_cast<epicsUInt32>(readVarint(p, end));
+        break;
+      case 7: // is_null
+        expectWireType(wireType, WIRE_VARINT);
+        metric.isNull = readVarint(p, end) != 0;
+        break;
+      case 10: // int_value
+        expectWireType(wireType, WIRE_VARINT);
+        metric.intValue = static_cast<epicsUInt32>(readVarint(p, end));
+        metric.kind = MqttSparkplugMetric::INT;
+        break;
+      case 11: // long_value
+        expectWireType(wireType, WIRE_VARINT);
+        metric.intValue = readVarint(p, end);
+        metric.kind = MqttSparkplugMetric::LONG;
+        break;
+      case 12: // float_value
+      {
+        expectWireType(wireType, WIRE_FIXED32);
+        epicsUInt32 bits = static_cast<epicsUInt32>(readFixed(p, end, 4));
+        float value;
+        memcpy(&value, &bits, sizeof(value));
+        metric.doubleValue = value;
+        metric.kind = MqttSparkplugMetric::FLOAT;
+        break;
+      }
+      case 13: // double_value
+      {
+        expectWireType(wireType, WIRE_FIXED64);
+        epicsUInt64 bits = readFixed(p, end, 8);
+        memcpy(&metric.doubleValue, &bits, sizeof(metric.doubleValue));
+        metric.kind = MqttSparkplugMetric::DOUBLE;
+        break;
+      }
+      case 14: // boolean_value
+        expectWireType(wireType, WIRE_VARINT);
+        metric.intValue = readVarint(p, end) != 0;
+        metric.kind = MqttSparkplugMetric::BOOLEAN;
+        break;
+      case 15: // string_value
+        expectWireType(wireType, WIRE_LEN);
+        metric.bytes = readBytes(p, end);
+        metric.kind = MqttSparkplugMetric::STRING;
+        break;
+      case 16: // bytes_value
+        expectWireType(wireType, WIRE_LEN);
+        metric.bytes = readBytes(p, end);
+        metric.kind = MqttSparkplugMetric::BYTES;
+        break;
+      default: // timestamp, metadata, properties, datasets, templates...
+        skipField(wireType, p, end);
+        break;
+    }
+  }
+}
+
+bool MqttSparkplugReader::next(MqttSparkplugMetric& metric) {
+  while (pos_ < end_) {
+    epicsUInt64 key = readVarint(pos_, end_);
+    unsigned wireType = static_cast<unsigned>(key & 7);
+    if ((key >> 3) == 2 && wireType == WIRE_LEN) { // Payload.metrics
+      std::string_view body = readBytes(pos_, end_);
+      parseMetric(body.data(), body.data() + body.size(), metric);
+      return true;
+    }
+    skipField(wireType, pos_, end_);
+  }
+  return false;
+}
+
+//#############################################################################################
+// Value conversions
+
+epicsInt64 MqttSparkplugMetric::toInt64() const {
+  switch (kind) {
+    case INT:
+      // signed types travel as the two's complement bits in a uint32
+      switch (datatype) {
+        case Int8: return static_cast<epicsInt8>(intValue);
+        case Int16: return static_cast<epicsInt16>(intValue);
+        case Int32: return static_cast<epicsInt32>(intValue);
+        default: return static_cast<epicsInt64>(intValue);
+      }
+    case LONG:
+      if (datatype != Int64 && intValue > static_cast<epicsUInt64>(std::numeric_limits<epicsInt64>::max()))
+        throw std::out_of_range("Integer out of range");
+      return static_cast<epicsInt64>(intValue);
+    case BOOLEAN:
+      return static_cast<epicsInt64>(intValue);
+    default:
+      throw std::invalid_argument("Invalid integer");
+  }
+}
+
+double MqttSparkplugMetric::toDouble() const {
+  switch (kind) {
+    case FLOAT:
+    case DOUBLE:
+      return doubleValue;
+    case LONG:
+      if (datatype != Int64) return static_cast<double>(intValue);
+      return static_cast<double>(static_cast<epicsInt64>(intValue));
+    case INT:
+    case BOOLEAN:
+      return static_cast<double>(toInt64());
+    default:
+      throw std::invalid_argument("Invalid float");
+  }
+}
+
+size_t MqttSparkplugMetric::arrayElementSize() const {
+  switch (datatype) {
+    case Int8Array: case UInt8Array: return 1;
+    case Int16Array: case UInt16Array: return 2;
+    case Int32Array: case UInt32Array: case FloatArray: return 4;
+    case Int64Array: case UInt64Array: case DoubleArray: return 8;
+    default: return 0; // BooleanArray (bit-packed) and string arrays are not supported
+  }
+}
+
+/* Little-endian bits of element i of a packed array */
+static epicsUInt64 arrayBits(const MqttSparkplugMetric& metric, size_t i) {
+  size_t size = metric.arrayElementSize();
+  const char* p = metric.bytes.data() + i * size;
+  return readFixed(p, metric.bytes.data() + metric.bytes.size(), size);
+}
+
+double MqttSparkplugMetric::arrayDouble(size_t i) const {
+  epicsUInt64 bits = arrayBits(*this, i);
+  switch (datatype) {
+    case FloatArray:
+    {
+      epicsUInt32 bits32 = static_cast<epicsUInt32>(bits);
+      float value;
+      memcpy(&value, &bits32, sizeof(value));
+      return value;
+    }
+    case DoubleArray:
+    {
+      double value;
+      memcpy(&value, &bits, sizeof(value));
+      return value;
+    }
+    case UInt64Array:
+      return static_cast<double>(bits);
+    default:
+      return static_cast<double>(arrayInt64(i));
+  }
+}
+
+epicsInt64 MqttSparkplugMetric::arrayInt64(size_t i) const {
+  epicsUInt64 bits = arrayBits(*this, i);
+  switch (datatype) {
+    case Int8Array: return static_cast<epicsInt8>(bits);
+    case Int16Array: return static_cast<epicsInt16>(bits);
+    case Int32Array: return static_cast<epicsInt32>(bits);
+    case UInt64Array:
+      if (bits > static_cast<epicsUInt64>(std::numeric_limits<epicsInt64>::max()))
+        throw std::out_of_range("Integer out of range");
+      return static_cast<epicsInt64>(bits);
+    case FloatArray:
+    case DoubleArray:
+      throw std::invalid_argument("Invalid integer");
+    default: return static_cast<epicsInt64>(bits);
+  }
+}
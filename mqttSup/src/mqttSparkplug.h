@@ -0,0 +1,93 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2026 André Favoto
+
+#ifndef MQTTSPARKPLUG_H
+#define MQTTSPARKPLUG_H
+#include <string>
+#include <string_view>
+#include <epicsTypes.h>
+
+/*! \brief Sparkplug B topic and payload decoding.
+ *
+ * Sparkplug B topics are "spBv1.0/<group>/<type>/<edge node>[/<device>]" and
+ * their payloads are protobuf-encoded org.eclipse.tahu.protobuf.Payload
+ * messages. Only the fields needed to route metric values are decoded (the
+ * protobuf is walked by hand, no generated code or protobuf runtime). All
+ * views point into the topic/payload given by the caller, so decoding does
+ * not allocate.
+ */
+struct MqttSparkplugTopic {
+  enum MessageType { NBIRTH, NDEATH, NDATA, NCMD, DBIRTH, DDEATH, DDATA, DCMD };
+
+  MessageType type;
+  std::string_view group;
+  std::string_view edgeNode;
+  std::string_view device; // empty for node messages
+
+  /* Parses a Sparkplug B node/device topic. Returns false for any other topic (including STATE). */
+  static bool parse(std::string_view topic, MqttSparkplugTopic& out);
+  bool isBirth() const { return type == NBIRTH || type == DBIRTH; }
+  bool isData() const { return type == NDATA || type == DDATA; }
+  bool isDeath() const { return type == NDEATH || type == DDEATH; }
+};
+
+/* One metric of a payload. Fields not present in the message keep their defaults. */
+struct MqttSparkplugMetric {
+  /* Sparkplug B DataType values */
+  enum DataType {
+    Int8 = 1, Int16 = 2, Int32 = 3, Int64 = 4, UInt8 = 5, UInt16 = 6, UInt32 = 7, UInt64 = 8,
+    Float = 9, Double = 10, Boolean = 11, String = 12, DateTime = 13, Text = 14, UUID = 15,
+    Bytes = 17,
+    Int8Array = 22, Int16Array = 23, Int32Array = 24, Int64Array = 25,
+    UInt8Array = 26, UInt16Array = 27, UInt32Array = 28, UInt64Array = 29,
+    FloatArray = 30, DoubleArray = 31, BooleanArray = 32
+  };
+  /* Which value field of the protobuf oneof was set */
+  enum ValueKind { NONE, INT, LONG, FLOAT, DOUBLE, BOOLEAN, STRING, BYTES };
+
+  std::string_view name;     // usually only sent in BIRTH messages
+  epicsUInt64 alias = 0;
+  bool hasAlias = false;
+  epicsUInt32 datatype = 0;  // 0 if not sent (DATA messages may omit it)
+  bool isNull = false;
+  ValueKind kind = NONE;
+  epicsUInt64 intValue = 0;  // INT, LONG and BOOLEAN
+  double doubleValue = 0;    // FLOAT and DOUBLE
+  std::string_view bytes;    // STRING and BYTES (packed arrays)
+
+  bool isNumeric() const { return kind == INT || kind == LONG || kind == FLOAT || kind == DOUBLE || kind == BOOLEAN; }
+  /* Numeric value with the sign given by datatype (Int8/16/32 travel as uint32).
+     Throw std::invalid_argument if the metric is not numeric. */
+  epicsInt64 toInt64() const;
+  double toDouble() const;
+  /* Packed array metrics: element size in bytes, 0 if datatype is not a supported array type */
+  size_t arrayElementSize() const;
+  size_t arrayLength() const { return arrayElementSize() ? bytes.size() / arrayElementSize() : 0; }
+  /* Element i of a packed array (little-endian). arrayInt64 throws std::invalid_argument
+     for float arrays, like toInt64 for float values. */
+  double arrayDouble(size_t i) const;
+  epicsInt64 arrayInt64(size_t i) const;
+  bool arrayIsFloat() const { return datatype == FloatArray || datatype == DoubleArray; }
+};
+
+/*! \brief Iterates over the metrics of a Sparkplug B payload.
+ *
+ *   MqttSparkplugReader reader(payload);
+ *   MqttSparkplugMetric metric;
+ *   while (reader.next(metric)) { ... }
+ *
+ * next() throws std::invalid_argument on malformed payloads; metrics
+ * returned before the error are valid.
+ */
+class MqttSparkplugReader {
+public:
+  explicit MqttSparkplugReader(std::string_view payload)
+    : pos_(payload.data()), end_(payload.data() + payload.size()) {}
+  bool next(MqttSparkplugMetric& metric);
+
+private:
+  const char* pos_;
+  const char* end_;
+};
+
+#endif
@@ -0,0 +1,47 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2026 André Favoto
+
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+#include "mqttTopic.h"
+
+/* Entries never move: the deque only grows at its end, and the index refers to their names */
+struct MqttTopicTable {
+  std::mutex mutex;
+  std::deque<MqttTopic::Entry> entries;
+  std::unordered_map<std::string_view, const MqttTopic::Entry*> byName;
+  const MqttTopic::Entry* empty;
+
+  MqttTopicTable() {
+    entries.push_back({ std::string(), 0 });
+    empty = &entries.back();
+    byName.emplace(empty->name, empty);
+  }
+};
+
+/* Created on first use, as addresses are parsed while other static objects may still be initialized */
+static MqttTopicTable& topicTable() {
+  static MqttTopicTable* table = new MqttTopicTable(); // never destroyed, handles may outlive static destructors
+  return *table;
+}
+
+MqttTopic::MqttTopic() : entry_(topicTable().empty) {
+}
+
+MqttTopic MqttTopic::intern(std::string_view name) {
+  MqttTopicTable& table = topicTable();
+  std::lock_guard<std::mutex> guard(table.mutex);
+  auto found = table.byName.find(name);
+  if (found != table.byName.end()) return MqttTopic(found->second);
+  table.entries.push_back({ std::string(name), static_cast<epicsUInt32>(table.entries.size()) });
+  const Entry* entry = &table.entries.back();
+  table.byName.emplace(entry->name, entry);
+  return MqttTopic(entry);
+}
+
+size_t MqttTopic::count() {
+  MqttTopicTable& table = topicTable();
+  std::lock_guard<std::mutex> guard(table.mutex);
+  return table.entries.size() - 1; // without the empty topic
+}
@@ -0,0 +1,51 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2026 André Favoto
+
+#ifndef MQTTTOPIC_H
+#define MQTTTOPIC_H
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <epicsTypes.h>
+
+/*! \brief Interned topic name.
+ *
+ * Record addresses keep a handle to their topic in a process-wide table
+ * instead of their own copy of its name: records on the same topic share
+ * one string, and handles compare and hash as their integer ID. Names are
+ * interned at record initialization and never removed, so name() stays
+ * valid for the life of the process and is read without locking.
+ */
+class MqttTopic {
+public:
+  /* The empty topic */
+  MqttTopic();
+  /* Handle of name, added to the table if it was not there yet. Thread-safe. */
+  static MqttTopic intern(std::string_view name);
+  /* Number of names interned so far */
+  static size_t count();
+
+  const std::string& name() const { return entry_->name; }
+  epicsUInt32 id() const { return entry_->id; }
+  bool operator==(const MqttTopic& other) const { return entry_ == other.entry_; }
+  bool operator!=(const MqttTopic& other) const { return entry_ != other.entry_; }
+
+private:
+  friend struct MqttTopicTable;
+  struct Entry {
+    std::string name;
+    epicsUInt32 id;
+  };
+  explicit MqttTopic(const Entry* entry) : entry_(entry) {}
+  const Entry* entry_;
+};
+
+namespace std {
+template <>
+struct hash<MqttTopic> {
+  size_t operator()(const MqttTopic& topic) const { return topic.id(); }
+};
+}
+
+#endif
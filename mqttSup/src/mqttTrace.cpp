@@ -0,0 +1,87 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2026 André Favoto
+
+#include <cstring>
+#include "mqttTrace.h"
+
+static_assert((MqttTrace::CAPACITY & (MqttTrace::CAPACITY - 1)) == 0, "Trace capacity must be a power of two");
+
+MqttTrace::MqttTrace() {}
+
+void MqttTrace::record(EventType type, const std::string& topic, size_t size) {
+  epicsUInt64 ticket = head_.fetch_add(1, std::memory_order_relaxed);
+  Slot& slot = slots_[ticket & (CAPACITY - 1)];
+  // odd sequence marks the slot as being written
+  slot.seq.store(2 * ticket + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  epicsTimeGetCurrent(&slot.event.time);
+  slot.event.type = type;
+  slot.event.size = static_cast<epicsUInt32>(size);
+  size_t len = topic.size() < TOPIC_LEN - 1 ? topic.size() : TOPIC_LEN - 1;
+  memcpy(slot.event.topic, topic.data(), len);
+  slot.event.topic[len] = '\0';
+
+  slot.seq.store(2 * ticket + 2, std::memory_order_release);
+}
+
+void MqttTrace::dump(FILE* fp, size_t count) const {
+  fprintf(fp, "messages: %llu (%llu bytes), published: %llu, subscribed: %llu\n",
+    (unsigned long long)counters.messages.load(std::memory_order_relaxed),
+    (unsigned long long)counters.bytes.load(std::memory_order_relaxed),
+    (unsigned long long)counters.published.load(std::memory_order_relaxed),
+    (unsigned long long)counters.subscribed.load(std::memory_order_relaxed));
+  fprintf(fp, "parse errors: %llu, operation failures: %llu, reconnects: %llu\n",
+    (unsigned long long)counters.parseErrors.load(std::memory_order_relaxed),
+    (unsigned long long)counters.opFailures.load(std::memory_order_relaxed),
+    (unsigned long long)counters.reconnects.load(std::memory_order_relaxed));
+
+  epicsUInt64 head = head_.load(std::memory_order_acquire);
+  if (count > CAPACITY) count = CAPACITY;
+  if (count > head) count = static_cast<size_t>(head);
+
+  for (epicsUInt64 ticket = head - count; ticket < head; ticket++) {
+    const Slot& slot = slots_[ticket & (CAPACITY - 1)];
+    epicsUInt64 before = slot.seq.load(std::memory_order_acquire);
+    if (before != 2 * ticket + 2) continue; // not yet written or already overwritten
+    Event ev = slot.event;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.seq.load(std::memory_order_relaxed) != before) continue; // torn read
+
+    char timeStr[40];
+    epicsTimeToStrftime(timeStr, sizeof(timeStr), "%Y-%m-%d %H:%M:%S.%06f", &ev.time);
+    fprintf(fp, "%s %-12s %8u '%s'\n", timeStr, eventName(ev.type), ev.size, ev.topic);
+  }
+}
+
+const char* MqttTrace::eventName(EventType type) {
+  switch (type) {
+    case EV_CONNECT: return "CONNECT";
+    case EV_DISCONNECT: return "DISCONNECT";
+    case EV_SUBSCRIBE: return "SUBSCRIBE";
+    case EV_PUBLISH: return "PUBLISH";
+    case EV_MESSAGE: return "MESSAGE";
+    case EV_PARSE_ERROR: return "PARSE_ERROR";
+    case EV_OP_FAILURE: return "OP_FAILURE";
+    case EV_UNSUBSCRIBE: return "UNSUBSCRIBE";
+  }
+  return "UNKNOWN";
+}
+
+//#############################################################################################
+
+MqttErrorLimiter::MqttErrorLimiter(double intervalSec)
+  : intervalNs_(static_cast<epicsUInt64>(intervalSec * 1e9)) {
+}
+
+bool MqttErrorLimiter::allow(epicsUInt64& suppressed) {
+  epicsUInt64 now = epicsMonotonicGet();
+  epicsUInt64 last = lastReportNs_.load(std::memory_order_relaxed);
+  if ((last == 0 || now - last >= intervalNs_) &&
+    lastReportNs_.compare_exchange_strong(last, now, std::memory_order_relaxed)) {
+    suppressed = suppressed_.exchange(0, std::memory_order_relaxed);
+    return true;
+  }
+  suppressed_.fetch_add(1, std::memory_order_relaxed);
+  return false;
+}
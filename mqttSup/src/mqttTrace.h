@@ -0,0 +1,97 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2026 André Favoto
+
+#ifndef MQTTTRACE_H
+#define MQTTTRACE_H
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <epicsTypes.h>
+#include <epicsTime.h>
+
+/*! \brief Fixed-size lock-free ring buffer of binary trace events.
+ *
+ * Hot-path callbacks (message, publish, subscribe) record a small binary
+ * event here instead of formatting a log line. Nothing is formatted until
+ * someone asks for a dump (see mqttTraceDump iocsh command), so tracing
+ * costs a couple of atomic operations and a short memcpy per event.
+ *
+ * Writers claim a slot with a single fetch_add and publish it through a
+ * per-slot sequence number (seqlock), so any number of producer threads can
+ * record concurrently. Readers discard slots that were overwritten while
+ * being copied.
+ */
+class MqttTrace {
+public:
+  enum EventType : epicsUInt8 {
+    EV_CONNECT,
+    EV_DISCONNECT,
+    EV_SUBSCRIBE,
+    EV_PUBLISH,
+    EV_MESSAGE,
+    EV_PARSE_ERROR,
+    EV_OP_FAILURE,
+    EV_UNSUBSCRIBE
+  };
+
+  static const size_t CAPACITY = 4096; // must be a power of two
+  static const size_t TOPIC_LEN = 64;  // topics are truncated to this length
+
+  struct Event {
+    epicsTimeStamp time;
+    epicsUInt32 size;   // payload size in bytes
+    EventType type;
+    char topic[TOPIC_LEN];
+  };
+
+  /* Hot-path counters, updated with relaxed atomics */
+  struct Counters {
+    std::atomic<epicsUInt64> messages{ 0 };
+    std::atomic<epicsUInt64> bytes{ 0 };
+    std::atomic<epicsUInt64> published{ 0 };
+    std::atomic<epicsUInt64> subscribed{ 0 };
+    std::atomic<epicsUInt64> parseErrors{ 0 };
+    std::atomic<epicsUInt64> opFailures{ 0 };
+    std::atomic<epicsUInt64> reconnects{ 0 };
+  };
+
+  MqttTrace();
+
+  void record(EventType type, const std::string& topic, size_t size = 0);
+  /* Prints counters and the last 'count' events (oldest first) */
+  void dump(FILE* fp, size_t count) const;
+
+  Counters counters;
+
+  static const char* eventName(EventType type);
+
+private:
+  struct Slot {
+    std::atomic<epicsUInt64> seq{ 0 }; // 0: never written; odd: being written
+    Event event;
+  };
+  std::atomic<epicsUInt64> head_{ 0 };
+  Slot slots_[CAPACITY];
+};
+
+/*! \brief Rate limiter for error reports.
+ *
+ * Errors are always counted, but at most one report is let through per
+ * interval. The next report carries the number of occurrences that were
+ * suppressed since the previous one, so floods are aggregated into a single
+ * line per interval instead of one line per message.
+ */
+class MqttErrorLimiter {
+public:
+  explicit MqttErrorLimiter(double intervalSec = 5.0);
+  /* Returns true if the caller should report. 'suppressed' receives the
+     number of errors swallowed since the last report. */
+  bool allow(epicsUInt64& suppressed);
+
+private:
+  const epicsUInt64 intervalNs_;
+  std::atomic<epicsUInt64> lastReportNs_{ 0 };
+  std::atomic<epicsUInt64> suppressed_{ 0 };
+};
+
+#endif /* MQTTTRACE_H */
@@ -0,0 +1,24 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2026 André Favoto
+
+#include <cstring>
+#include "mqttTransport.h"
+#include "mqttClient.h"
+#include "mqttLoopback.h"
+
+std::unique_ptr<MqttTransport> MqttTransport::create(const Config& cfg) {
+  if (cfg.brokerUrl.compare(0, strlen(LoopbackTransport::URL_SCHEME), LoopbackTransport::URL_SCHEME) == 0)
+    return std::unique_ptr<MqttTransport>(new LoopbackTransport(cfg));
+  return std::unique_ptr<MqttTransport>(new MqttClient(cfg));
+}
+
+void MqttTransport::startCapture(const std::string& path) {
+  captureWriter_.open(path);
+  capturing_.store(true);
+}
+
+uint64_t MqttTransport::stopCapture() {
+  capturing_.store(false);
+  captureWriter_.close();
+  return captureWriter_.recordCount();
+}
@@ -0,0 +1,115 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2026 André Favoto
+
+#ifndef MQTTTRANSPORT_H
+#define MQTTTRANSPORT_H
+#include <string>
+#include <vector>
+#include <functional>
+#include <memory>
+#include <atomic>
+#include "mqttCapture.h"
+
+/*! \brief Abstract MQTT transport used by the driver.
+ *
+ * The driver only talks to the broker through this interface. The default
+ * implementation is the Paho-based MqttClient; LoopbackTransport is an
+ * in-process implementation used to benchmark the driver without a broker.
+ * Use MqttTransport::create() to get the implementation matching a broker URL.
+ */
+class MqttTransport {
+public:
+  struct Config {
+    std::string brokerUrl = "mqtt://localhost:1883";
+    std::string clientId = "MqttClient";
+    int qos = 1;
+    int keepAliveInterval = 20;
+    bool cleanStart = true;
+    /* MQTT v5 session expiry interval in seconds, only relevant if cleanStart is false */
+    int sessionExpiry = 0;
+    /* Directory for durable client-side persistence of in-flight messages
+       (empty: in-memory, lost on restart) */
+    std::string persistDir;
+    /* Reconnect policy: the delay between attempts starts at reconnectMinDelay
+       seconds and doubles after every failure up to reconnectMaxDelay. Each
+       delay is randomly shortened by up to reconnectJitter (0..1) of itself,
+       so a fleet of clients does not retry in lockstep. */
+    double reconnectMinDelay = 1;
+    double reconnectMaxDelay = 60;
+    double reconnectJitter = 0.5;
+
+    // For future SSL support
+    std::string sslCaCert;
+    std::string sslCert;
+    std::string sslKey;
+  };
+
+  using ConnectionCallback = std::function<void(const std::string& reason)>;
+  using DisconnectionCallback = std::function<void(const std::string& reason)>;
+  using MessageCallback = std::function<void(const std::string& topic, const std::string& payload)>;
+  using SubscriptionCallback = std::function<void(const std::string& topic)>;
+  using PublishCallback = std::function<void(const std::string& topic)>;
+  using OpFailCallback = std::function<void(const std::string& message)>;
+
+  virtual ~MqttTransport() {}
+
+  virtual void connect() = 0;
+  virtual void disconnect() = 0;
+  virtual void reconnect() = 0;
+  virtual void subscribe(const std::string& topic) = 0;
+  /* Subscribes to several topics at once. Implementations that support it
+     send a single SUBSCRIBE request; the default subscribes one by one. */
+  virtual void subscribe(const std::vector<std::string>& topics) {
+    for (const auto& topic : topics) subscribe(topic);
+  }
+  /* Subscribes to topics on a resumed session. Implementations that support
+     it ask the broker (MQTT 5 retain handling) to send retained messages only
+     for topics the session was not subscribed to yet; the default subscribes. */
+  virtual void resubscribe(const std::vector<std::string>& topics) { subscribe(topics); }
+  virtual void unsubscribe(const std::string& topic) = 0;
+  virtual void publish(const std::string& topic, const std::string& payload, int qos = -1, bool retained = false) = 0;
+  /* True if the broker resumed a previous session on the last connection, in
+     which case its subscriptions are still in place */
+  virtual bool sessionPresent() const { return false; }
+
+  void setConnectionCb(ConnectionCallback cb) { connectionCb_ = std::move(cb); }
+  /* Set callback for "connection_lost" event.
+
+    NOTE: reconnect() is called by default if no disconnection callback is set.
+    If a disconnection callback is set, is up to the user to call the reconnect
+    routine as needed.
+  */
+  void setDisconnectionCb(DisconnectionCallback cb) { disconnectionCb_ = std::move(cb); }
+  void setMessageCb(MessageCallback cb) { messageCb_ = std::move(cb); }
+  void setSubscriptionCb(SubscriptionCallback cb) { subscriptionCb_ = std::move(cb); }
+  void setPublishCb(PublishCallback cb) { publishCb_ = std::move(cb); }
+  void setOpFailCb(OpFailCallback cb) { opFailCb_ = std::move(cb); }
+
+  /* Starts writing every received message (topic, payload, QoS, retained flag
+     and arrival time) to a capture log, see mqttCapture.h. Throws on failure. */
+  void startCapture(const std::string& path);
+  /* Stops capturing and returns the number of captured messages */
+  uint64_t stopCapture();
+
+  /* Creates the transport for cfg.brokerUrl: "loopback://..." URLs get a
+     LoopbackTransport, everything else the Paho MqttClient. */
+  static std::unique_ptr<MqttTransport> create(const Config& cfg);
+
+protected:
+  /* Implementations call this for every received message, before the message callback */
+  void capture(const std::string& topic, const std::string& payload, int qos, bool retained) {
+    if (capturing_.load(std::memory_order_relaxed)) captureWriter_.write(topic, payload, qos, retained);
+  }
+
+  MessageCallback messageCb_;
+  ConnectionCallback connectionCb_;
+  DisconnectionCallback disconnectionCb_;
+  OpFailCallback opFailCb_;
+  SubscriptionCallback subscriptionCb_;
+  PublishCallback publishCb_;
+
+private:
+  std::atomic<bool> capturing_{ false };
+  MqttCaptureWriter captureWriter_;
+};
+#endif
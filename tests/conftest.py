@@ -17,6 +17,10 @@ TESTS_DIR = Path(__file__).resolve().parent
 PV_PREFIX = "mqtt:test:"
 # Default mosquitto installation binds to 1883. Use a non-default port to avoid conflict.
 BROKER_PORT = 18830
+# Sparkplug B group of the SPB test records, unique per session (group names cannot hold the topic root's slashes)
+SPB_GROUP = f"epicsMQTT-ci-{uuid.uuid4().hex[:10]}"
+# Root of the test record topics, unique per session
+TOPIC_ROOT = f"epicsMQTT/ci/{uuid.uuid4().hex[:10]}"
 
 
 @pytest.fixture(scope="session")
@@ -48,12 +52,30 @@ def mqtt_broker():
         proc.kill()
 
 
+@pytest.fixture
+def mqtt_publisher(mqtt_broker):
+    """Paho client connected to the local broker, for tests that publish raw payloads."""
+    mqtt = pytest.importorskip("paho.mqtt.client")
+
+    if hasattr(mqtt, "CallbackAPIVersion"):  # paho-mqtt >= 2.0
+        client = mqtt.Client(mqtt.CallbackAPIVersion.VERSION2)
+    else:
+        client = mqtt.Client()
+    client.connect("localhost", BROKER_PORT)
+    client.loop_start()
+    yield client
+
+    client.loop_stop()
+    client.disconnect()
+
+
 @pytest.fixture(scope="session")
 def pva_context(mqtt_broker):
     env = os.environ.copy()
     env["MQTT_TEST_CLIENT_ID"] = f"epicsMQTT-ci-{uuid.uuid4().hex[:10]}"
-    env["MQTT_TEST_TOPIC_ROOT"] = f"epicsMQTT/ci/{uuid.uuid4().hex[:10]}"
+    env["MQTT_TEST_TOPIC_ROOT"] = TOPIC_ROOT
     env["MQTT_TEST_BROKER_URL"] = mqtt_broker
+    env["MQTT_TEST_SPB_GROUP"] = SPB_GROUP
 
     ioc_proc = subprocess.Popen(
         ["./st.cmd"],
@@ -0,0 +1,262 @@
+# SPDX-License-Identifier: GPL-3.0-or-later
+# Copyright (C) 2026 André Favoto
+
+"""Throughput and latency load test for the MQTT driver.
+
+Opt-in: set MQTT_LOAD_TEST=1 to run it. It reuses the session Mosquitto
+broker from conftest.py, boots a dedicated IOC with a generated database of
+FLAT:FLOAT and JSON:FLOAT records, publishes at increasing rates and measures
+publish-to-PV latency through PVA monitors. Every published value is the
+publish timestamp itself, so latency is computed when the monitor update
+arrives.
+
+Tunables (environment):
+  MQTT_LOAD_RECORDS   records per format (default 2000)
+  MQTT_LOAD_RATES     comma-separated publish rates in msgs/s (default 500,2000,5000)
+  MQTT_LOAD_DURATION  seconds per rate step (default 5)
+  MQTT_LOAD_RESULTS   results file (default tests/load-results.json)
+"""
+
+import glob
+import json
+import os
+import statistics
+import subprocess
+import threading
+import time
+import uuid
+from pathlib import Path
+
+import pytest
+
+from conftest import BROKER_PORT, ROOT
+
+pytestmark = pytest.mark.skipif(
+    os.environ.get("MQTT_LOAD_TEST") != "1", reason="load test is opt-in (set MQTT_LOAD_TEST=1)"
+)
+
+RECORDS = int(os.environ.get("MQTT_LOAD_RECORDS", "2000"))
+RATES = [int(r) for r in os.environ.get("MQTT_LOAD_RATES", "500,2000,5000").split(",")]
+DURATION = float(os.environ.get("MQTT_LOAD_DURATION", "5"))
+RESULTS_FILE = Path(os.environ.get("MQTT_LOAD_RESULTS", Path(__file__).resolve().parent / "load-results.json"))
+PV_PREFIX = "mqtt:load:"
+FORMATS = ("flat", "json")
+# time allowed for in-flight updates to arrive after a rate step ends
+DRAIN_TIME = 2.0
+
+
+def _pv_name(fmt, index):
+    return f"{PV_PREFIX}{fmt}{index}"
+
+
+def _topic(topic_root, fmt, index):
+    return f"{topic_root}/{fmt}/{index}"
+
+
+def _payload(fmt, timestamp, seq):
+    if fmt == "flat":
+        return repr(timestamp)
+    return json.dumps({"seq": seq, "device": "load", "t": timestamp})
+
+
+def _generate_database(path, topic_root):
+    with open(path, "w") as db:
+        for index in range(RECORDS):
+            db.write(
+                f'record(ai, "{_pv_name("flat", index)}") {{\n'
+                f'  field(DTYP, "asynFloat64")\n'
+                f'  field(SCAN, "I/O Intr")\n'
+                f'  field(PREC, "6")\n'
+                f'  field(INP, "@asyn($(PORT)) FLAT:FLOAT {_topic(topic_root, "flat", index)}")\n'
+                f"}}\n"
+            )
+            db.write(
+                f'record(ai, "{_pv_name("json", index)}") {{\n'
+                f'  field(DTYP, "asynFloat64")\n'
+                f'  field(SCAN, "I/O Intr")\n'
+                f'  field(PREC, "6")\n'
+                f'  field(INP, "@asyn($(PORT)) JSON:FLOAT {_topic(topic_root, "json", index)} t")\n'
+                f"}}\n"
+            )
+
+
+def _find_ioc_binary():
+    arch = os.environ.get("EPICS_HOST_ARCH")
+    candidates = [ROOT / "bin" / arch / "test"] if arch else []
+    candidates += [Path(p) for p in glob.glob(str(ROOT / "bin" / "*" / "test"))]
+    for candidate in candidates:
+        if candidate.is_file():
+            return candidate
+    raise RuntimeError("Test IOC binary not found, build the module first")
+
+
+def _driver_version():
+    try:
+        return subprocess.check_output(
+            ["git", "describe", "--always", "--dirty"], cwd=ROOT, text=True
+        ).strip()
+    except Exception:
+        return "unknown"
+
+
+@pytest.fixture(scope="module")
+def load_ioc(mqtt_broker, tmp_path_factory):
+    """Boot an IOC with the generated load database, return its topic root."""
+    workdir = tmp_path_factory.mktemp("load-ioc")
+    topic_root = f"epicsMQTT/load/{uuid.uuid4().hex[:10]}"
+    db_path = workdir / "load.db"
+    _generate_database(db_path, topic_root)
+
+    st_cmd = workdir / "st.cmd"
+    st_cmd.write_text(
+        f'dbLoadDatabase "{ROOT}/dbd/test.dbd"\n'
+        "test_registerRecordDeviceDriver pdbbase\n"
+        f'mqttDriverConfigure("mqttLoad", "{mqtt_broker}", "epicsMQTT-load-{uuid.uuid4().hex[:10]}", 0)\n'
+        f'dbLoadRecords("{db_path}", "PORT=mqttLoad")\n'
+        "iocInit\n"
+    )
+    log = open(workdir / "ioc.log", "w")
+    ioc_proc = subprocess.Popen(
+        [str(_find_ioc_binary()), str(st_cmd)],
+        cwd=workdir,
+        stdin=subprocess.PIPE,
+        stdout=log,
+        stderr=subprocess.STDOUT,
+        text=True,
+    )
+    try:
+        yield topic_root
+    finally:
+        ioc_proc.terminate()
+        try:
+            ioc_proc.wait(timeout=10)
+        except subprocess.TimeoutExpired:
+            ioc_proc.kill()
+        log.close()
+
+
+class _LatencyCollector:
+    """Collects publish-to-monitor latencies for every monitored PV."""
+
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.latencies = {fmt: [] for fmt in FORMATS}
+        self.active = False
+
+    def callback(self, fmt):
+        def on_update(value):
+            now = time.time()
+            if isinstance(value, Exception) or not self.active:
+                return
+            with self.lock:
+                self.latencies[fmt].append(now - float(value))
+
+        return on_update
+
+    def take(self):
+        with self.lock:
+            taken = self.latencies
+            self.latencies = {fmt: [] for fmt in FORMATS}
+        return taken
+
+
+def _percentile(sorted_values, fraction):
+    if not sorted_values:
+        return None
+    return sorted_values[min(len(sorted_values) - 1, int(fraction * len(sorted_values)))]
+
+
+def _wait_for_subscriptions(publisher, context, topic_root, timeout=30.0):
+    """Publish probes until the last record of each format sees them."""
+    deadline = time.monotonic() + timeout
+    for fmt in FORMATS:
+        index = RECORDS - 1
+        while True:
+            probe = time.time()
+            publisher.publish(_topic(topic_root, fmt, index), _payload(fmt, probe, 0))
+            time.sleep(0.2)
+            if abs(float(context.get(_pv_name(fmt, index), timeout=2.0)) - probe) < 1e-3:
+                break
+            if time.monotonic() > deadline:
+                raise RuntimeError(f"IOC did not subscribe to {fmt} topics in time")
+
+
+def test_load_throughput_and_latency(load_ioc):
+    paho = pytest.importorskip("paho.mqtt.client")
+    from p4p.client.thread import Context
+
+    topic_root = load_ioc
+    client_id = f"epicsMQTT-load-pub-{uuid.uuid4().hex[:10]}"
+    if hasattr(paho, "CallbackAPIVersion"):  # paho-mqtt >= 2.0
+        publisher = paho.Client(paho.CallbackAPIVersion.VERSION2, client_id=client_id)
+    else:
+        publisher = paho.Client(client_id=client_id)
+    publisher.connect("localhost", BROKER_PORT)
+    publisher.loop_start()
+
+    context = Context("pva")
+    collector = _LatencyCollector()
+    subscriptions = []
+    results = {
+        "driver_version": _driver_version(),
+        "records_per_format": RECORDS,
+        "step_duration_s": DURATION,
+        "timestamp": time.strftime("%Y-%m-%dT%H:%M:%S%z"),
+        "steps": [],
+    }
+    try:
+        _wait_for_subscriptions(publisher, context, topic_root)
+        for fmt in FORMATS:
+            for index in range(RECORDS):
+                subscriptions.append(context.monitor(_pv_name(fmt, index), collector.callback(fmt)))
+        time.sleep(2.0)  # let monitors connect and deliver their initial values
+        collector.take()
+
+        for rate in RATES:
+            published = {fmt: 0 for fmt in FORMATS}
+            collector.active = True
+            period = 1.0 / rate
+            start = time.perf_counter()
+            next_time = start
+            seq = 0
+            while time.perf_counter() - start < DURATION:
+                fmt = FORMATS[seq % len(FORMATS)]
+                index = (seq // len(FORMATS)) % RECORDS
+                publisher.publish(_topic(topic_root, fmt, index), _payload(fmt, time.time(), seq))
+                published[fmt] += 1
+                seq += 1
+                next_time += period
+                delay = next_time - time.perf_counter()
+                if delay > 0:
+                    time.sleep(delay)
+            elapsed = time.perf_counter() - start
+            time.sleep(DRAIN_TIME)
+            collector.active = False
+            latencies = collector.take()
+
+            step = {"target_rate": rate, "achieved_publish_rate": seq / elapsed, "formats": {}}
+            for fmt in FORMATS:
+                values = sorted(latencies[fmt])
+                received = len(values)
+                step["formats"][fmt] = {
+                    "published": published[fmt],
+                    "received": received,
+                    "dropped": max(0, published[fmt] - received),
+                    "received_rate": received / elapsed,
+                    "latency_p50_ms": _percentile(values, 0.50) * 1e3 if values else None,
+                    "latency_p99_ms": _percentile(values, 0.99) * 1e3 if values else None,
+                    "latency_mean_ms": statistics.fmean(values) * 1e3 if values else None,
+                }
+            results["steps"].append(step)
+    finally:
+        for subscription in subscriptions:
+            subscription.close()
+        context.close()
+        publisher.loop_stop()
+        publisher.disconnect()
+        RESULTS_FILE.write_text(json.dumps(results, indent=2) + "\n")
+
+    assert results["steps"], "no load steps were run"
+    for step in results["steps"]:
+        for fmt in FORMATS:
+            assert step["formats"][fmt]["received"] > 0, f"no {fmt} updates at {step['target_rate']} msgs/s"
@@ -2,11 +2,14 @@
 # Copyright (C) 2026 André Favoto
 
 import math
+import struct
 import time
 from pathlib import Path
 
 import pytest
 
+from conftest import SPB_GROUP, TOPIC_ROOT
+
 
 IOC_LOG = Path(__file__).resolve().parents[1] / "iocBoot" / "ioctest" / "pytest-ioc.log"
 
@@ -51,29 +54,142 @@ def _readback_matches(actual, expected):
     return actual == expected
 
 
-def _put_and_wait(context, output_pv, input_pv, value, timeout=10.0):
-    context.put(output_pv, value, timeout=10.0)
-
+def _wait_for(condition, message, timeout=10.0):
+    """Polls condition() until it is true, fails with message after timeout seconds."""
     deadline = time.monotonic() + timeout
-    last_value = None
     while time.monotonic() < deadline:
-        last_value = context.get(input_pv, timeout=2.0)
-        if _readback_matches(last_value, value):
+        if condition():
             return
         time.sleep(0.5)
+    raise AssertionError(message)
+
 
-    raise AssertionError(f"Round-trip timed out for {output_pv} / {input_pv}. ")
+def _wait_for_value(context, pv, value, message, timeout=10.0):
+    _wait_for(lambda: _readback_matches(context.get(pv, timeout=2.0), value), message, timeout)
+
+
+def _put_and_wait(context, output_pv, input_pv, value, timeout=10.0):
+    context.put(output_pv, value, timeout=10.0)
+    _wait_for_value(context, input_pv, value, f"Round-trip timed out for {output_pv} / {input_pv}. ", timeout)
 
 
 @pytest.mark.parametrize(
     ("output_pv", "input_pv", "value"),
     [
         ("mqtt:test:Int32Output", "mqtt:test:Int32Input", 42),
+        ("mqtt:test:Int64Output", "mqtt:test:Int64Input", 2**53 + 1),
         ("mqtt:test:Float64Output", "mqtt:test:Float64Input", 3.14159),
         ("mqtt:test:StringOutput", "mqtt:test:StringInput", "epicsMQTT-ci"),
         ("mqtt:test:IntArrayOutput", "mqtt:test:IntArrayInput", [1, 2, 3, 4, 5]),
+        ("mqtt:test:Int64ArrayOutput", "mqtt:test:Int64ArrayInput", [-(2**62), 0, 2**40 + 7]),
         ("mqtt:test:FloatArrayOutput", "mqtt:test:FloatArrayInput", [1.1, 2.2, 3.3, 4.4, 5.5]),
+        ("mqtt:test:Int16ArrayBinOutput", "mqtt:test:Int16ArrayBinInput", [-32768, -1, 0, 1, 32767]),
+        ("mqtt:test:Float32ArrayOutput", "mqtt:test:Float32ArrayInput", [1.5, -2.25, 1024.0]),
+        ("mqtt:test:CborFloat64Output", "mqtt:test:CborFloat64Input", 2.71828),
+        ("mqtt:test:CborNestedOutput", "mqtt:test:CborNestedInput", -6.5),
+        ("mqtt:test:MsgpackIntArrayOutput", "mqtt:test:MsgpackIntArrayInput", [7, -8, 65536]),
+        ("mqtt:test:JsonFloat64Output", "mqtt:test:JsonFloat64Input", -0.125),
+        ("mqtt:test:JsonStringOutput", "mqtt:test:JsonStringInput", 'say "hi"'),
     ],
 )
 def test_round_trip_via_broker(pva_context, output_pv, input_pv, value):
     _put_and_wait(pva_context, output_pv, input_pv, value)
+
+
+def test_json_slice_into_waveform(pva_context):
+    # the output publishes {"data": [...]}, the input reads data[1:4] of it
+    pva_context.put("mqtt:test:JsonWaveformOutput", [0.5, 1.5, 2.5, 3.5, 4.5], timeout=10.0)
+    _wait_for_value(pva_context, "mqtt:test:JsonSliceInput", [1.5, 2.5, 3.5], "JSON slice was not read into its waveform")
+
+
+def test_json_empty_slice_is_rejected(pva_context, mqtt_publisher):
+    pva_context.put("mqtt:test:JsonWaveformOutput", [0.5, 1.5, 2.5, 3.5, 4.5], timeout=10.0)
+    _wait_for_value(pva_context, "mqtt:test:JsonSliceInput", [1.5, 2.5, 3.5], "JSON slice was not read into its waveform")
+
+    # an empty array and a slice past the end of the array have no elements: the waveform keeps its value
+    topic = f"{TOPIC_ROOT}/json/waveform"
+    mqtt_publisher.publish(topic, '{"data": []}', qos=1).wait_for_publish()
+    mqtt_publisher.publish(topic, '{"data": [9.5]}', qos=1).wait_for_publish()
+    time.sleep(2.0)
+    assert _readback_matches(pva_context.get("mqtt:test:JsonSliceInput", timeout=2.0), [1.5, 2.5, 3.5])
+
+
+def _pb_varint(value):
+    out = bytearray()
+    while value >= 0x80:
+        out.append((value & 0x7F) | 0x80)
+        value >>= 7
+    out.append(value)
+    return bytes(out)
+
+
+def _pb_field(number, wire_type, data):
+    return _pb_varint((number << 3) | wire_type) + data
+
+
+def _sparkplug_double(value, alias, name=None):
+    """Encodes a Sparkplug B Payload with one Double metric (name only sent in BIRTH messages)."""
+    metric = b""
+    if name is not None:
+        encoded = name.encode()
+        metric += _pb_field(1, 2, _pb_varint(len(encoded)) + encoded)
+    metric += _pb_field(2, 0, _pb_varint(alias))
+    metric += _pb_field(4, 0, _pb_varint(10))  # DataType Double
+    metric += _pb_field(13, 1, struct.pack("<d", value))
+    return _pb_field(2, 2, _pb_varint(len(metric)) + metric)
+
+
+def _sparkplug_bdseq(seq):
+    """Encodes an NBIRTH/NDEATH Payload with only its bdSeq metric (Int64)."""
+    name = b"bdSeq"
+    metric = _pb_field(1, 2, _pb_varint(len(name)) + name)
+    metric += _pb_field(4, 0, _pb_varint(4))  # DataType Int64
+    metric += _pb_field(11, 0, _pb_varint(seq))
+    return _pb_field(2, 2, _pb_varint(len(metric)) + metric)
+
+
+def test_sparkplug_alias_routing(pva_context, mqtt_publisher):
+    topic = f"spBv1.0/{SPB_GROUP}/%s/edge/device"
+    mqtt_publisher.publish(topic % "DBIRTH", _sparkplug_double(1.0, 7, "Outlet/Pressure"), qos=1).wait_for_publish()
+    # DATA messages only carry the alias learned from the BIRTH
+    mqtt_publisher.publish(topic % "DDATA", _sparkplug_double(4.25, 7), qos=1).wait_for_publish()
+    _wait_for_value(pva_context, "mqtt:test:SparkplugFloat64Input", 4.25, "Sparkplug DDATA was not routed to its record")
+
+
+def test_sparkplug_node_death_invalidates_devices(pva_context, mqtt_publisher):
+    node = f"spBv1.0/{SPB_GROUP}/%s/edge"
+    device = node + "/device"
+    mqtt_publisher.publish(node % "NBIRTH", _sparkplug_bdseq(5), qos=1).wait_for_publish()
+    mqtt_publisher.publish(device % "DBIRTH", _sparkplug_double(2.5, 7, "Outlet/Pressure"), qos=1).wait_for_publish()
+    _wait_for_value(pva_context, "mqtt:test:SparkplugFloat64Input", 2.5, "Sparkplug DBIRTH was not routed to its record")
+
+    # death certificate of an older session: ignored
+    mqtt_publisher.publish(node % "NDEATH", _sparkplug_bdseq(4), qos=1).wait_for_publish()
+    time.sleep(2.0)
+    assert pva_context.get("mqtt:test:SparkplugFloat64Input", timeout=2.0).severity == 0
+
+    mqtt_publisher.publish(node % "NDEATH", _sparkplug_bdseq(5), qos=1).wait_for_publish()
+    _wait_for(
+        lambda: pva_context.get("mqtt:test:SparkplugFloat64Input", timeout=2.0).severity == 3,  # INVALID
+        "NDEATH did not invalidate the device metrics of the node",
+    )
+
+
+def _image_frame(width, height, pixels, reserved=b"\x00\x00\x00"):
+    """Encodes a uint8 image frame: width, height, data type and reserved bytes, then the pixels."""
+    return struct.pack("<HHB", width, height, 1) + reserved + bytes(pixels)
+
+
+def _image_pixels(context):
+    return context.get("mqtt:test:Image", timeout=2.0).ravel().tolist()
+
+
+def test_image_rejects_reserved_header_bytes(pva_context, mqtt_publisher):
+    topic = f"{TOPIC_ROOT}/image"
+    mqtt_publisher.publish(topic, _image_frame(2, 2, [1, 2, 3, 4]), qos=1).wait_for_publish()
+    _wait_for(lambda: _image_pixels(pva_context) == [1, 2, 3, 4], "Image frame was not posted")
+
+    # a frame in another layout must not be decoded as this one
+    mqtt_publisher.publish(topic, _image_frame(2, 2, [5, 6, 7, 8], reserved=b"\x01\x00\x00"), qos=1).wait_for_publish()
+    time.sleep(2.0)
+    assert _image_pixels(pva_context) == [1, 2, 3, 4]